@@ -41,214 +41,597 @@
  */
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <string.h>
 #include "lcd.h"
+#include "trace.h"
 #include <util/delay.h>
 
+/*
+ * Access to the pins in the hot paths. With LCD_FAST_IO these are virtual
+ * port accesses that compile to sbi, cbi, in and out. E is a pin of the
+ * display that is written, its mask is only known at run time. A virtual
+ * port would then take a read-modify-write that an interrupt can break
+ * into, so E is always set and cleared with a store to OUTSET and OUTCLR.
+ */
+#define LCD_E_HIGH(lcd)       ((lcd)->e_port->OUTSET = (lcd)->e_bm)
+#define LCD_E_LOW(lcd)        ((lcd)->e_port->OUTCLR = (lcd)->e_bm)
+#if LCD_FAST_IO==1
+#define LCD_RS_HIGH()         (LCD_COMM_VPORT.OUT |= LCD_RS_bm)
+#define LCD_RS_LOW()          (LCD_COMM_VPORT.OUT &= (uint8_t)~LCD_RS_bm)
+#define LCD_RW_HIGH()         (LCD_COMM_VPORT.OUT |= LCD_RW_bm)
+#define LCD_RW_LOW()          (LCD_COMM_VPORT.OUT &= (uint8_t)~LCD_RW_bm)
+#define LCD_DATA_WRITE(b)     (LCD_DATA_VPORT.OUT = (b))
+#define LCD_DATA_TOGGLE(m)    (LCD_DATA_VPORT.OUT ^= (m))
+#define LCD_DATA_READ()       (LCD_DATA_VPORT.IN)
+#define LCD_DATA_INPUT()      (LCD_DATA_VPORT.DIR &= (uint8_t)~LCD_DATA_PORT_gm)
+#define LCD_DATA_OUTPUT()     (LCD_DATA_VPORT.DIR |= LCD_DATA_PORT_gm)
+#else
+#define LCD_RS_HIGH()         (LCD_RS_PORT.OUTSET = LCD_RS_bm)
+#define LCD_RS_LOW()          (LCD_RS_PORT.OUTCLR = LCD_RS_bm)
+#define LCD_RW_HIGH()         (LCD_RW_PORT.OUTSET = LCD_RW_bm)
+#define LCD_RW_LOW()          (LCD_RW_PORT.OUTCLR = LCD_RW_bm)
+#define LCD_DATA_WRITE(b)     (LCD_DATA_PORT.OUT = (b))
+#define LCD_DATA_TOGGLE(m)    (LCD_DATA_PORT.OUTTGL = (m))
+#define LCD_DATA_READ()       (LCD_DATA_PORT.IN)
+#define LCD_DATA_INPUT()      (LCD_DATA_PORT.DIRCLR = LCD_DATA_PORT_gm)
+#define LCD_DATA_OUTPUT()     (LCD_DATA_PORT.DIRSET = LCD_DATA_PORT_gm)
+#endif
+
 static inline void set_rs(uint8_t rs)
 {
   if (rs) {
-    LCD_RS_PORT.OUTSET = LCD_RS_bm;  // RS high (data)
+    LCD_RS_HIGH();                   // RS high (data)
   } else {
-    LCD_RS_PORT.OUTCLR = LCD_RS_bm;  // RS low (command)
+    LCD_RS_LOW();                    // RS low (command)
   }
 }
 
-static inline void enable_puls(void)
+static inline void enable_puls(lcd_t *lcd)
 {
-  LCD_E_PORT.OUTSET  = LCD_E_bm;     // make E high
+  LCD_E_HIGH(lcd);                   // make E high
   _delay_us(TPWE_us);
-  LCD_E_PORT.OUTCLR  = LCD_E_bm;     // make E low
+  LCD_E_LOW(lcd);                    // make E low
+}
+
+/*
+ * Translation between a nibble and the data pins in 4 bit mode.
+ * When D4..D7 are consecutive pins in the right order this is a shift.
+ * Otherwise the preprocessor generates a 16 byte table in flash from
+ * LCD_D4_bp..LCD_D7_bp for writing and, when the four pins lie within
+ * four consecutive bits, also for reading.
+ */
+#define LCD_NIBBLE_LINEAR  ((LCD_D5_bp==LCD_D4_bp+1) && (LCD_D6_bp==LCD_D4_bp+2) && (LCD_D7_bp==LCD_D4_bp+3))
+
+#define LCD_MIN(a,b)       ((a) < (b) ? (a) : (b))
+#define LCD_MAX(a,b)       ((a) > (b) ? (a) : (b))
+#define LCD_D_MIN_bp       LCD_MIN(LCD_MIN(LCD_D4_bp, LCD_D5_bp), LCD_MIN(LCD_D6_bp, LCD_D7_bp))
+#define LCD_D_MAX_bp       LCD_MAX(LCD_MAX(LCD_D4_bp, LCD_D5_bp), LCD_MAX(LCD_D6_bp, LCD_D7_bp))
+
+#define LCD_TABLE16(f)     f(0), f(1), f(2),  f(3),  f(4),  f(5),  f(6),  f(7), \
+                           f(8), f(9), f(10), f(11), f(12), f(13), f(14), f(15)
+
+#define LCD_NIBBLE_BITS(n) ((((n) >> 3) & 0x01) << (LCD_D7_bp) | \
+                            (((n) >> 2) & 0x01) << (LCD_D6_bp) | \
+                            (((n) >> 1) & 0x01) << (LCD_D5_bp) | \
+                            (((n) >> 0) & 0x01) << (LCD_D4_bp))
+#define LCD_PINS_BITS(x)   ((((x) >> (LCD_D7_bp)) & 0x01) << 3 | \
+                            (((x) >> (LCD_D6_bp)) & 0x01) << 2 | \
+                            (((x) >> (LCD_D5_bp)) & 0x01) << 1 | \
+                            (((x) >> (LCD_D4_bp)) & 0x01) << 0)
+#define LCD_WINDOW_BITS(i) LCD_PINS_BITS((i) << LCD_D_MIN_bp)
+
+#if LCD_NIBBLE_LINEAR
+#define LCD_NIBBLE_TO_PINS(n)  ((uint8_t)((n) << LCD_D4_bp))
+#define LCD_PINS_TO_NIBBLE(x)  (((x) >> LCD_D4_bp) & 0x0F)
+#else
+static const uint8_t lcd_nibble_to_pins[16] PROGMEM = { LCD_TABLE16(LCD_NIBBLE_BITS) };
+#define LCD_NIBBLE_TO_PINS(n)  pgm_read_byte(&lcd_nibble_to_pins[(n)])
+#if (LCD_D_MAX_bp - LCD_D_MIN_bp) == 3
+static const uint8_t lcd_pins_to_nibble[16] PROGMEM = { LCD_TABLE16(LCD_WINDOW_BITS) };
+#define LCD_PINS_TO_NIBBLE(x)  pgm_read_byte(&lcd_pins_to_nibble[((x) >> LCD_D_MIN_bp) & 0x0F])
+#else
+#define LCD_PINS_TO_NIBBLE(x)  LCD_PINS_BITS(x)
+#endif
+#endif
+
+static uint8_t lcd_data_pins = 0;    // data pins as last written in 4 bit mode, shared by all displays
+
+/*
+ * Only the data pins that change are toggled, so the port is written
+ * once and never read.
+ */
+static inline void write_nibble(uint8_t n)
+{
+  uint8_t pins = LCD_NIBBLE_TO_PINS(n);
+
+  LCD_DATA_TOGGLE(lcd_data_pins ^ pins);
+  lcd_data_pins        = pins;
 }
 
 static inline void write_high_nibble(uint8_t b)
 {
-  LCD_DATA_PORT.OUT    = (LCD_DATA_PORT.OUT & (~(LCD_DATA_PORT_gm))) |
-                         (((b >> 7) & (0x01)) << (LCD_D7_bp)) |
-                         (((b >> 6) & (0x01)) << (LCD_D6_bp)) |
-                         (((b >> 5) & (0x01)) << (LCD_D5_bp)) |
-                         (((b >> 4) & (0x01)) << (LCD_D4_bp)) ;
+  write_nibble(b >> 4);
 }
 
 static inline void write_low_nibble(uint8_t b)
 {
-	LCD_DATA_PORT.OUT    = (LCD_DATA_PORT.OUT & (~(LCD_DATA_PORT_gm))) |
-	(((b >> 3) & (0x01)) << (LCD_D7_bp)) |
-	(((b >> 2) & (0x01)) << (LCD_D6_bp)) |
-	(((b >> 1) & (0x01)) << (LCD_D5_bp)) |
-	(((b >> 0) & (0x01)) << (LCD_D4_bp)) ;
+  write_nibble(b & 0x0F);
 }
 
-static inline void start_init_byte(void)
+static inline void start_init_byte(lcd_t *lcd)
 {
   _delay_ms(TDELAY1_ms);
   set_rs(0);
   LCD_DATA_PORT.OUT = LCD_FUNCTION_8BIT;
-  enable_puls();
+  enable_puls(lcd);
   _delay_ms(TDELAY2_ms);
   LCD_DATA_PORT.OUT = LCD_FUNCTION_8BIT;
-  enable_puls();
+  enable_puls(lcd);
   _delay_us(TDELAY3_us);
   LCD_DATA_PORT.OUT = LCD_FUNCTION_8BIT;
-  enable_puls();
+  enable_puls(lcd);
   _delay_us(TDELAY_us);
 }
 
-static inline void start_init_nibble(void)
+static inline void start_init_nibble(lcd_t *lcd)
 {
   _delay_ms(TDELAY1_ms);
   set_rs(0);
   write_high_nibble(LCD_FUNCTION_8BIT);
-  enable_puls();
+  enable_puls(lcd);
   _delay_ms(TDELAY2_ms);
   write_high_nibble(LCD_FUNCTION_8BIT);
-  enable_puls();
+  enable_puls(lcd);
   _delay_us(TDELAY3_us);
   write_high_nibble(LCD_FUNCTION_8BIT);
-  enable_puls();
+  enable_puls(lcd);
   _delay_us(TDELAY_us);
   write_high_nibble(LCD_FUNCTION_4BIT);
-  enable_puls();
+  enable_puls(lcd);
   _delay_us(TDELAY_us);
 }
 
-static void lcd8_write_byte (uint8_t b, uint8_t rs) {
-  set_rs(rs);
-  LCD_DATA_PORT.OUT  = b;            // assign data
-  enable_puls();
-  _delay_us(TDELAY_us);
+#if LCD_BUSY_FLAG!=0 || LCD_QUEUE==1
+#define LCD_US_TO_TICKS(us)  ((uint16_t)(((F_CPU/1000000UL)*(us)+LCD_TC_DIV-1)/LCD_TC_DIV))
+
+/*
+ * LCD_TC runs free from the first lcd_init() on and is never reset, all
+ * waits and execution times are differences of its count. So the displays
+ * can share it.
+ */
+static inline void lcd_tc_start(void)
+{
+  LCD_TC.PER   = 0xFFFF;
+  LCD_TC.CTRLA = LCD_TC_CLKSEL;
+}
+#endif
+
+#if LCD_BUSY_FLAG!=0
+#define LCD_TIMEOUT        0xFFFF
+#define LCD_WAIT_EXEC(lcd) lcd_wait_ticks((lcd)->tdelay)
+
+static void lcd_wait_ticks(uint16_t ticks)
+{
+  uint16_t start = LCD_TC.CNT;
+
+  while ( (uint16_t)(LCD_TC.CNT - start) < ticks ) ;
 }
 
-static void lcd8bf_write_byte (uint8_t b, uint8_t rs) {
+static inline uint8_t lcd8_read_status(lcd_t *lcd)
+{
   uint8_t x;
 
-  LCD_DATA_PORT.DIRCLR = LCD_DATA_PORT_gm;  // read data
-  LCD_RW_PORT.OUTSET   = LCD_RW_bm;         // R/W high
-  LCD_RS_PORT.OUTCLR   = LCD_RS_bm;         // RS low (command)
-  do {
-    LCD_E_PORT.OUTSET  = LCD_E_bm;          // make E high
-    _delay_us(TPWE_us);
-    x = LCD_DATA_PORT.IN;
-    LCD_E_PORT.OUTCLR  = LCD_E_bm;          // make E low
-  } while (x & (1<<LCD_BUSY_bp));
-
-  LCD_DATA_PORT.DIRSET = LCD_DATA_PORT_gm;  // write data
-  LCD_RW_PORT.OUTCLR = LCD_RW_bm;           // R/W low
+  LCD_E_HIGH(lcd);                        // make E high
+  _delay_us(TPWE_us);
+  x = LCD_DATA_READ();
+  LCD_E_LOW(lcd);                         // make E low
+
+  return x;
+}
+
+static inline uint8_t lcd4_read_status(lcd_t *lcd)
+{
+  uint8_t x;
+
+  uint8_t pins;
+
+  LCD_E_HIGH(lcd);                          // make E high
+  _delay_us(TPWE_us);
+  pins = LCD_DATA_READ();
+  LCD_E_LOW(lcd);                           // make E low
+  x = LCD_PINS_TO_NIBBLE(pins) << 4;
+
+  _delay_us(TPWE_us);
+  LCD_E_HIGH(lcd);                          // make E high
+  _delay_us(TPWE_us);
+  pins = LCD_DATA_READ();
+  LCD_E_LOW(lcd);                           // make E low
+  x |= LCD_PINS_TO_NIBBLE(pins);
+
+  return x;
+}
+
+#if LCD_4BIT_MODE==1
+#define LCD_READ_STATUS(lcd)  lcd4_read_status(lcd)
+#else
+#define LCD_READ_STATUS(lcd)  lcd8_read_status(lcd)
+#endif
+
+/*
+ * Waits until the busy flag is cleared, but not longer than timeout ticks
+ * of LCD_TC. Returns the number of ticks waited or LCD_TIMEOUT.
+ */
+static uint16_t lcd_wait_busy(lcd_t *lcd, uint16_t timeout)
+{
+  uint16_t start, t;
+
+  LCD_DATA_INPUT();                         // read data
+  LCD_RW_HIGH();                            // R/W high
+  LCD_RS_LOW();                             // RS low (command)
+  start = LCD_TC.CNT;
+  while (1) {
+    t = LCD_TC.CNT - start;
+    if ( !(LCD_READ_STATUS(lcd) & (1<<LCD_BUSY_bp)) ) {
+      break;
+    }
+    if ( t >= timeout ) {
+      t = LCD_TIMEOUT;
+      break;
+    }
+  }
+  LCD_DATA_OUTPUT();                        // write data
+  LCD_RW_LOW();                             // R/W low
+
+  return t;
+}
+
+/*
+ * The busy flag does not work: use the fixed delays from now on.
+ */
+static void lcd_busy_fault(lcd_t *lcd)
+{
+  lcd->fault |= LCD_FAULT_BUSY_bm;
+  lcd->tdelay = LCD_US_TO_TICKS(TDELAY_us);
+  lcd->tclear = LCD_US_TO_TICKS(T_CLEARDISPLAY_us);
+}
+
+/*
+ * Waits until the LCD can accept the next byte.
+ */
+static void lcd_wait_ready(lcd_t *lcd)
+{
+  if ( lcd->fault & LCD_FAULT_BUSY_bm ) {
+    lcd_wait_ticks(lcd->fallback);
+  } else if ( lcd_wait_busy(lcd, LCD_US_TO_TICKS(LCD_BUSY_TIMEOUT_us)) == LCD_TIMEOUT ) {
+    lcd_busy_fault(lcd);
+  }
+}
+#else
+#define LCD_WAIT_EXEC(lcd) _delay_us(TDELAY_us)
+#endif
+
+static inline void lcd8_out_byte (lcd_t *lcd, uint8_t b, uint8_t rs) {
   set_rs(rs);
-  LCD_DATA_PORT.OUT = b;         // assign data
-  enable_puls();
+  LCD_DATA_WRITE(b);                 // assign data
+  enable_puls(lcd);
 }
 
-static void lcd4_write_byte (uint8_t b, uint8_t rs) {
+static void lcd8_write_byte (lcd_t *lcd, uint8_t b, uint8_t rs) {
+  TRACE_BEGIN(TRACE_LCD_BYTE);
+  lcd8_out_byte(lcd, b, rs);
+  LCD_WAIT_EXEC(lcd);
+  TRACE_END(TRACE_LCD_BYTE);
+}
+
+static inline void lcd4_out_byte (lcd_t *lcd, uint8_t b, uint8_t rs) {
   set_rs(rs);
   write_high_nibble(b);
-  enable_puls();
+  enable_puls(lcd);
   write_low_nibble(b);
-  enable_puls();
-  _delay_us(TDELAY_us);
+  enable_puls(lcd);
 }
 
-static void lcd4bf_write_byte (uint8_t b, uint8_t rs) {
-  uint8_t x;
+static void lcd4_write_byte (lcd_t *lcd, uint8_t b, uint8_t rs) {
+  TRACE_BEGIN(TRACE_LCD_BYTE);
+  lcd4_out_byte(lcd, b, rs);
+  LCD_WAIT_EXEC(lcd);
+  TRACE_END(TRACE_LCD_BYTE);
+}
 
-  LCD_DATA_PORT.DIRCLR  = LCD_DATA_PORT_gm;   // read data
-  LCD_RW_PORT.OUTSET    = LCD_RW_bm;          // R/W high
-  LCD_RS_PORT.OUTCLR    = LCD_RS_bm;          // RS low (command)
-  do {
-    LCD_E_PORT.OUTSET  = LCD_E_bm;            // make E high
-    _delay_us(TPWE_us);
-    x = (((LCD_DATA_PORT.IN & LCD_D7_bm) >> LCD_D7_bp) << 7) |
-        (((LCD_DATA_PORT.IN & LCD_D6_bm) >> LCD_D6_bp) << 6) |
-        (((LCD_DATA_PORT.IN & LCD_D5_bm) >> LCD_D5_bp) << 5) |
-       (((LCD_DATA_PORT.IN & LCD_D4_bm) >> LCD_D4_bp) << 4) ;
-
-    LCD_E_PORT.OUTCLR  = LCD_E_bm;            // make E low
-    _delay_us(TPWE_us);
-    LCD_E_PORT.OUTSET  = LCD_E_bm;            // make E high
-    _delay_us(TPWE_us);
-    x |= (((LCD_DATA_PORT.IN & LCD_D7_bm) >> LCD_D7_bp) << 3) |
-         (((LCD_DATA_PORT.IN & LCD_D6_bm) >> LCD_D6_bp) << 2) |
-         (((LCD_DATA_PORT.IN & LCD_D5_bm) >> LCD_D5_bp) << 1) |
-         (((LCD_DATA_PORT.IN & LCD_D4_bm) >> LCD_D4_bp)) ;
-
-    LCD_E_PORT.OUTCLR  = LCD_E_bm;            // make E low
-  } while (x & (1<<LCD_BUSY_bp));
-
-  LCD_DATA_PORT.DIRSET  = LCD_DATA_PORT_gm;   // write data
-  LCD_RW_PORT.OUTCLR    = LCD_RW_bm;          // R/W low
+#if LCD_BUSY_FLAG!=0
+static void lcd8bf_write_byte (lcd_t *lcd, uint8_t b, uint8_t rs) {
+  TRACE_BEGIN(TRACE_LCD_BYTE);
+  lcd_wait_ready(lcd);
+  lcd8_out_byte(lcd, b, rs);
+  lcd->fallback = lcd->tdelay;
+  TRACE_END(TRACE_LCD_BYTE);
+}
 
-  set_rs(rs);
-  write_high_nibble(b);
-  enable_puls();
-  write_low_nibble(b);
-  enable_puls();
+static void lcd4bf_write_byte (lcd_t *lcd, uint8_t b, uint8_t rs) {
+  TRACE_BEGIN(TRACE_LCD_BYTE);
+  lcd_wait_ready(lcd);
+  lcd4_out_byte(lcd, b, rs);
+  lcd->fallback = lcd->tdelay;
+  TRACE_END(TRACE_LCD_BYTE);
 }
 
-static inline void lcd8_init(void)
+/*
+ * Measures the execution time of a command, a data write and a clear
+ * with the busy flag. The measured times plus 25% are used from now on.
+ */
+static void lcd_calibrate(lcd_t *lcd)
 {
-  LCD_DATA_PORT.DIR    = LCD_DATA_PORT_gm;     // 8-bits data port are outputs
-  LCD_COMM_PORT.DIRSET = LCD_RS_bm|LCD_E_bm;   // RS and E are outputs
+  uint16_t t, tdata, tclear;
+
+  lcd_wait_ready(lcd);                 // the previous byte may still be executing
+  if ( lcd->fault & LCD_FAULT_BUSY_bm ) {
+    return;
+  }
+  LCD_OUT_BYTE(lcd, LCD_ENTRY_INC, 0);
+  t = lcd_wait_busy(lcd, LCD_US_TO_TICKS(LCD_BUSY_TIMEOUT_us));
+  LCD_OUT_BYTE(lcd, ' ', 1);
+  tdata = lcd_wait_busy(lcd, LCD_US_TO_TICKS(LCD_BUSY_TIMEOUT_us));
+  LCD_OUT_BYTE(lcd, 1<<LCD_CLR_bp, 0);
+  tclear = lcd_wait_busy(lcd, LCD_US_TO_TICKS(LCD_BUSY_TIMEOUT_us));
 
-  start_init_byte();
-  lcd8_write_byte(LCD_FUNCTION_8BIT_2LINES,0);
-  lcd8_write_byte(LCD_DISP_ON,0);
-  lcd8_write_byte(LCD_ENTRY_INC,0);
-  lcd_clear();
+  if ( (t == LCD_TIMEOUT) || (tdata == LCD_TIMEOUT) || (tclear == LCD_TIMEOUT) ) {
+    lcd_busy_fault(lcd);
+    return;
+  }
+  if ( tdata > t ) {
+    t = tdata;
+  }
+  lcd->tdelay   = t + (t >> 2) + 1;
+  lcd->tclear   = tclear + (tclear >> 2) + 1;
+  lcd->fallback = lcd->tdelay;
 }
+#endif
 
-static inline void lcd8bf_init(void)
+static inline void lcd8_init(lcd_t *lcd)
 {
   LCD_DATA_PORT.DIR    = LCD_DATA_PORT_gm;     // 8-bits data port are outputs
-  LCD_COMM_PORT.DIRSET = LCD_RS_bm|LCD_E_bm;   // RS and E are outputs
-  LCD_COMM_PORT.DIRSET = LCD_RW_bm;            // RW is output
-  LCD_COMM_PORT.OUTCLR = LCD_RW_bm;            // RW is low
+  LCD_RS_PORT.DIRSET   = LCD_RS_bm;            // RS and E are outputs
+  lcd->e_port->DIRSET  = lcd->e_bm;
 
-  start_init_byte();
-  lcd8_write_byte(LCD_FUNCTION_8BIT_2LINES,0);
-  lcd8bf_write_byte(LCD_DISP_ON,0);
-  lcd8bf_write_byte(LCD_ENTRY_INC,0);
-  lcd_clear();
+  start_init_byte(lcd);
+  lcd8_write_byte(lcd, LCD_FUNCTION_8BIT_2LINES,0);
+  lcd8_write_byte(lcd, LCD_DISP_ON,0);
+  lcd8_write_byte(lcd, LCD_ENTRY_INC,0);
+  lcd_clear(lcd);
 }
 
-static inline void lcd4_init(void)
+static inline void lcd4_init(lcd_t *lcd)
 {
   LCD_DATA_PORT.DIRSET  = LCD_DATA_PORT_gm;     // 4-bits data port are outputs
-  LCD_COMM_PORT.DIRSET  = LCD_RS_bm|LCD_E_bm;   // RS and E are outputs
+  LCD_RS_PORT.DIRSET    = LCD_RS_bm;            // RS and E are outputs
+  lcd->e_port->DIRSET   = lcd->e_bm;
+  lcd_data_pins = LCD_DATA_PORT.OUT & LCD_DATA_PORT_gm;
 
-  start_init_nibble();
+  start_init_nibble(lcd);
 
-  lcd4_write_byte(LCD_FUNCTION_4BIT_2LINES,0);
-  lcd4_write_byte(LCD_DISP_ON,0);
-  lcd4_write_byte(LCD_ENTRY_INC,0);
-  lcd_clear();
+  lcd4_write_byte(lcd, LCD_FUNCTION_4BIT_2LINES,0);
+  lcd4_write_byte(lcd, LCD_DISP_ON,0);
+  lcd4_write_byte(lcd, LCD_ENTRY_INC,0);
+  lcd_clear(lcd);
 }
 
-static inline void lcd4bf_init(void)
+#if LCD_BUSY_FLAG!=0
+static inline void lcd8bf_init(lcd_t *lcd)
+{
+  LCD_DATA_PORT.DIR    = LCD_DATA_PORT_gm;     // 8-bits data port are outputs
+  LCD_RS_PORT.DIRSET   = LCD_RS_bm;            // RS and E are outputs
+  lcd->e_port->DIRSET  = lcd->e_bm;
+  LCD_RW_PORT.DIRSET   = LCD_RW_bm;            // RW is output
+  LCD_RW_PORT.OUTCLR   = LCD_RW_bm;            // RW is low
+
+  start_init_byte(lcd);
+  lcd8_write_byte(lcd, LCD_FUNCTION_8BIT_2LINES,0);
+  lcd8bf_write_byte(lcd, LCD_DISP_ON,0);
+  lcd8bf_write_byte(lcd, LCD_ENTRY_INC,0);
+  lcd_calibrate(lcd);
+  lcd_clear(lcd);
+}
+
+static inline void lcd4bf_init(lcd_t *lcd)
 {
   LCD_DATA_PORT.DIRSET = LCD_DATA_PORT_gm;     // 4-bits data port are outputs
-  LCD_COMM_PORT.DIRSET = LCD_RS_bm|LCD_E_bm;   // RS and E are outputs
-  LCD_COMM_PORT.DIRSET = LCD_RW_bm;            // RW is output
-  LCD_COMM_PORT.OUTCLR = LCD_RW_bm;            // RW is output
+  LCD_RS_PORT.DIRSET   = LCD_RS_bm;            // RS and E are outputs
+  lcd->e_port->DIRSET  = lcd->e_bm;
+  LCD_RW_PORT.DIRSET   = LCD_RW_bm;            // RW is output
+  LCD_RW_PORT.OUTCLR   = LCD_RW_bm;            // RW is low
+  lcd_data_pins = LCD_DATA_PORT.OUT & LCD_DATA_PORT_gm;
+
+  start_init_nibble(lcd);
+
+  lcd4bf_write_byte(lcd, LCD_FUNCTION_4BIT_2LINES,0);
+  lcd4bf_write_byte(lcd, LCD_DISP_ON,0);
+  lcd4bf_write_byte(lcd, LCD_ENTRY_INC,0);
+  lcd_calibrate(lcd);
+  lcd_clear(lcd);
+}
+#endif
+
+#if LCD_QUEUE==1
+#define LCD_TC_LEAD        4         // ticks a compare must lie ahead of the count
+
+static lcd_t *lcd_panels = NULL;     // displays with a queue, served by the interrupt
+
+/*
+ * Sends the next byte of every display that has executed its previous
+ * byte, and sets the compare of LCD_TC to the first display that gets
+ * ready after that. While one display executes a byte the bus is free
+ * for the others, so their execution times overlap.
+ * Must be called from the interrupt or with the interrupts disabled.
+ */
+static void lcd_queue_run(void)
+{
+  lcd_t *lcd;
+  uint16_t first = 0;
+  uint8_t pending, tail, flags;
+
+  LCD_TC.INTFLAGS = TC1_CCAIF_bm;
+  do {
+    pending = 0;
+    for (lcd = lcd_panels; lcd; lcd = lcd->next) {
+      if ( lcd->busy && (int16_t)(LCD_TC.CNT - lcd->ready) >= 0 ) {
+        lcd->busy = 0;
+      }
+      tail = lcd->queue_tail;
+      if ( !lcd->busy && (tail != lcd->queue_head) ) {
+        flags = lcd->queue_flags[tail];
+        LCD_OUT_BYTE(lcd, lcd->queue_data[tail], flags & LCD_QUEUE_RS);
+        lcd->queue_tail = (tail + 1) & (LCD_QUEUE_SIZE - 1);
+        lcd->ready = LCD_TC.CNT + ((flags & LCD_QUEUE_SLOW) ? lcd->tclear : lcd->tdelay);
+        lcd->busy  = 1;
+      }
+      if ( lcd->busy && (!pending || (int16_t)(lcd->ready - first) < 0) ) {
+        first   = lcd->ready;
+        pending = 1;
+      }
+    }
+    if ( !pending ) {
+      LCD_TC.INTCTRLB = TC_CCAINTLVL_OFF_gc;   // all displays are idle
+      return;
+    }
+    LCD_TC.CCA = first;
+  } while ( (int16_t)(first - LCD_TC.CNT) < LCD_TC_LEAD );
+  LCD_TC.INTCTRLB = TC_CCAINTLVL_LO_gc;
+}
+
+/*
+ * Drives the queues by polling when the global interrupts are disabled,
+ * so waiting for a full queue can not dead lock.
+ */
+static void lcd_queue_poll(void)
+{
+  if ( !(SREG & CPU_I_bm) && (LCD_TC.INTFLAGS & TC1_CCAIF_bm) ) {
+    lcd_queue_run();
+  }
+}
 
-  start_init_nibble();
+/*
+ * Empties the queue of the display and adds it to the displays served by
+ * the interrupt. The interrupt stays off until the first byte is queued,
+ * so it does not use the bus during the initialization.
+ */
+static inline void lcd_queue_init(lcd_t *lcd)
+{
+  lcd_t *p;
+
+  LCD_TC.INTCTRLB = TC_CCAINTLVL_OFF_gc;
+  LCD_TC.CTRLB    = TC_WGMODE_NORMAL_gc;
+  PMIC.CTRL      |= PMIC_LOLVLEN_bm;
+  lcd->queue_head = 0;
+  lcd->queue_tail = 0;
+  lcd->busy       = 0;
+  for (p = lcd_panels; p && (p != lcd); p = p->next) ;
+  if ( !p ) {
+    lcd->next  = lcd_panels;
+    lcd_panels = lcd;
+  }
+}
 
-  lcd4bf_write_byte(LCD_FUNCTION_4BIT_2LINES,0);
-  lcd4bf_write_byte(LCD_DISP_ON,0);
-  lcd4bf_write_byte(LCD_ENTRY_INC,0);
-  lcd_clear();
+ISR(LCD_TC_CCA_vect)
+{
+  lcd_queue_run();
 }
 
-volatile uint8_t lcd_line = 0;   //!< Current line number (0 is first line)
+#define LCD_WRITE_SLOW_CMD(lcd,cmd)  lcd_enqueue((lcd), (cmd), LCD_QUEUE_SLOW)
+#elif LCD_BUSY_FLAG==1
+#define LCD_WRITE_SLOW_CMD(lcd,cmd)  do { LCD_WRITE_BYTE((lcd), (cmd), 0); (lcd)->fallback = (lcd)->tclear; } while (0)
+#elif LCD_BUSY_FLAG==2
+#define LCD_WRITE_SLOW_CMD(lcd,cmd)  do { LCD_OUT_BYTE((lcd), (cmd), 0); lcd_wait_ticks((lcd)->tclear); } while (0)
+#else
+#define LCD_WRITE_SLOW_CMD(lcd,cmd)  do { LCD_WRITE_BYTE((lcd), (cmd), 0); _delay_us(T_CLEARDISPLAY_us); } while (0)
+#endif
+
+#if LCD_GLYPH_CACHE==1
+static inline void lcd_glyph_init(lcd_t *lcd)
+{
+  uint8_t i;
+
+  for (i = 0; i < LCD_GLYPH_SLOTS; i++) {
+    lcd->glyph_id[i]  = LCD_GLYPH_NONE;
+    lcd->glyph_lru[i] = i;
+  }
+}
+#endif
+
+#if LCD_FRAMEBUFFER==1
+#define LCD_CURSOR_UNKNOWN(lcd)    ((lcd)->cursor_x = 0xFF)
+#define LCD_CONTENTS_UNKNOWN(lcd)  ((lcd)->fb_valid = 0)
+#else
+#define LCD_CURSOR_UNKNOWN(lcd)
+#define LCD_CONTENTS_UNKNOWN(lcd)
+#endif
+// a write past the framebuffer changes the DDRAM and moves the address counter
+#define LCD_SCREEN_UNKNOWN(lcd)    do { LCD_CONTENTS_UNKNOWN(lcd); LCD_CURSOR_UNKNOWN(lcd); } while (0)
 
 /*! \brief Initialize the lcd.
  *
  *  This function initializes the LCD in one of the four modes depending
  *  on de values of LCD_4BIT_MODE and LCD_BUSY_FLAG in the header file.
+ *  The data lines, RS and R/W are shared by all displays, e_port and e_bp
+ *  select the E line of this display.
+ *
+ *  \param  lcd       the display
+ *  \param  e_port    port of the E line
+ *  \param  e_bp      bit position of the E line
+ *  \param  lines     visible lines: 1, 2 or 4, 0 counts as 1 and 3 as 2
+ *  \param  length    visible characters per line, 1 to LCD_MAX_LENGTH
  *
  *  \return           none
  */
-void lcd_init(void)
+void lcd_init(lcd_t *lcd, PORT_t *e_port, uint8_t e_bp, uint8_t lines, uint8_t length)
 {
-  LCD_INIT();
+  lcd->e_port = e_port;
+  lcd->e_bm   = 1 << e_bp;
+  // lines - 1 must not wrap, and LCD_START_LINE() only knows 1, 2 and 4 lines
+  if ( lines == 0 ) {
+    lines = 1;
+  } else if ( lines == 3 ) {
+    lines = 2;
+  } else if ( lines > LCD_MAX_LINES ) {
+    lines = LCD_MAX_LINES;
+  }
+  if ( length == 0 ) {
+    length = 1;
+  } else if ( length > LCD_MAX_LENGTH ) {
+    length = LCD_MAX_LENGTH;
+  }
+  lcd->lines  = lines;
+  lcd->length = length;
+  lcd->line   = 0;
+  lcd->fault  = 0;
+#if LCD_BUSY_FLAG!=0 || LCD_QUEUE==1
+  lcd->tdelay = LCD_US_TO_TICKS(TDELAY_us);
+  lcd->tclear = LCD_US_TO_TICKS(T_CLEARDISPLAY_us);
+  lcd_tc_start();
+#endif
+#if LCD_BUSY_FLAG!=0
+  lcd->fallback = LCD_US_TO_TICKS(T_CLEARDISPLAY_us);
+#endif
+#if LCD_FAST_IO==1
+  PORTCFG.VPCTRLA = LCD_DATA_VPMAP | LCD_COMM_VPMAP;
+#endif
+#if LCD_QUEUE==1
+  lcd_queue_init(lcd);
+#endif
+#if LCD_GLYPH_CACHE==1
+  lcd_glyph_init(lcd);
+#endif
+#if LCD_MARQUEE==1
+  lcd->marquee = NULL;
+#endif
+#if LCD_TEMPLATE==1
+  lcd->tpl = NULL;
+#endif
+  LCD_INIT(lcd);
+#if LCD_FRAMEBUFFER==1
+  lcd_fb_clear(lcd);
+#endif
 }
 
 /*! \brief Writes a character to the LCD.
@@ -258,23 +641,24 @@ void lcd_init(void)
  *  - '\\n' (new line) :  go to the start of the next line
  *  - '\\f' (formfeed) :  clears display and start at the home position
  *
+ *  \param  lcd       the display
  *  \param  c         the character to be written
  *
  *  \return           none
  */
-void lcd_putc(char c)
+void lcd_putc(lcd_t *lcd, char c)
 {
   switch (c) {
     case '\f':
-      lcd_clear();
-      lcd_line = 0;
+      lcd_clear(lcd);
       break;
     case '\n':
-      if (++lcd_line==LCD_LINES) lcd_line = 0;
-      lcd_gotoxy(0, lcd_line);
+      if (++lcd->line==lcd->lines) lcd->line = 0;
+      lcd_gotoxy(lcd, 0, lcd->line);
       break;
     default:
-      LCD_WRITE_BYTE(c, 1);
+      LCD_SCREEN_UNKNOWN(lcd);
+      LCD_WRITE_BYTE(lcd, c, 1);
       break;
   }
 }
@@ -283,42 +667,104 @@ void lcd_putc(char c)
  *
  *  This function writes a command char to the LCD.
  *
+ *  \param  lcd       the display
  *  \param  cmd       command character
  *
  *  \return           none
  */
-void lcd_cmd(uint8_t cmd)
+void lcd_cmd(lcd_t *lcd, uint8_t cmd)
+{
+  LCD_SCREEN_UNKNOWN(lcd);
+  LCD_WRITE_BYTE(lcd, cmd, 0);
+}
+
+/*! \brief Returns the status of the LCD driver.
+ *
+ *  This function returns the faults detected by the driver.
+ *  LCD_FAULT_BUSY_bm is set when the busy flag did not clear within
+ *  LCD_BUSY_TIMEOUT_us. The driver then uses the fixed delays.
+ *
+ *  \param  lcd       the display
+ *
+ *  \return           0 or LCD_FAULT_..._bm flags
+ */
+uint8_t lcd_status(lcd_t *lcd)
 {
-  LCD_WRITE_BYTE(cmd, 0);
+  return lcd->fault;
+}
+
+/*! \brief Returns the execution time that is used for a command.
+ *
+ *  This function returns the execution time in microseconds that the driver
+ *  waits after a command or data byte. With the busyflag this is the time
+ *  measured by lcd_init(), otherwise TDELAY_us or T_CLEARDISPLAY_us.
+ *
+ *  \param  lcd       the display
+ *  \param  slow      0 for commands and data, 1 for clear and home
+ *
+ *  \return           execution time in microseconds
+ */
+uint16_t lcd_exec_time_us(lcd_t *lcd, uint8_t slow)
+{
+#if LCD_BUSY_FLAG!=0 || LCD_QUEUE==1
+  uint16_t t = slow ? lcd->tclear : lcd->tdelay;
+
+  return (uint16_t)(((uint32_t)t * LCD_TC_DIV) / (F_CPU/1000000UL));
+#else
+  (void)lcd;
+  return slow ? T_CLEARDISPLAY_us : TDELAY_us;
+#endif
 }
 
 /*! \brief Writes a data byte to the LCD.
  *
  *  This function writes a data byte to the LCD.
  *
+ *  \param  lcd       the display
  *  \param  b         data byte
  *
  *  \return           none
  */
-void lcd_data(uint8_t b)
+void lcd_data(lcd_t *lcd, uint8_t b)
 {
-  LCD_WRITE_BYTE(b, 1);
+  LCD_SCREEN_UNKNOWN(lcd);
+  LCD_WRITE_BYTE(lcd, b, 1);
 }
 
 /*! \brief Writes a string to the LCD.
  *
  *  This function writes a character string to the LCD.
  *
+ *  \param  lcd       the display
  *  \param  s         pointer to the character string
  *
  *  \return           none
  */
-void lcd_puts(char *s)
+void lcd_puts(lcd_t *lcd, const char *s)
 {
   char c;
 
   while ( (c = *s++) ) {
-    lcd_putc(c);
+    lcd_putc(lcd, c);
+  }
+}
+
+/*! \brief Writes a string from flash to the LCD.
+ *
+ *  This function writes a character string that is in flash, e.g. made
+ *  with PSTR(), to the LCD. It takes no SRAM for the string.
+ *
+ *  \param  lcd       the display
+ *  \param  s         pointer to the character string in flash
+ *
+ *  \return           none
+ */
+void lcd_puts_P(lcd_t *lcd, const char *s)
+{
+  char c;
+
+  while ( (c = pgm_read_byte(s++)) ) {
+    lcd_putc(lcd, c);
   }
 }
 
@@ -326,60 +772,672 @@ void lcd_puts(char *s)
  *
  *  This function sets the cursor to the specified position.
  *
+ *  \param  lcd       the display
  *  \param  x         horizontal position (0: left most position)
  *  \param  y         vertical   position (0: first line)
  *
  *  \return           none
  */
-void lcd_gotoxy(uint8_t x, uint8_t y)
+void lcd_gotoxy(lcd_t *lcd, uint8_t x, uint8_t y)
 {
-  uint8_t address;
+  if ( y >= lcd->lines ) {
+    y = lcd->lines - 1;
+  }
+  LCD_CURSOR_UNKNOWN(lcd);
+  LCD_WRITE_BYTE(lcd, (1<<LCD_DDRAM_bp) | (LCD_START_LINE(y, lcd->length) + x), 0);
+}
 
-#if LCD_LINES==1
-  address = LCD_START_LINE1;
-#elif LCD_LINES==2
-  if ( y==0 ) {
-    address = LCD_START_LINE1;
-  } else {
-    address = LCD_START_LINE2;
+/*! \brief Clear lcd.
+ *
+ *  This function clears the LCD and sets cursor to home position.
+ *
+ *  \param  lcd       the display
+ *
+ *  \return           none
+ */
+void lcd_clear(lcd_t *lcd)
+{
+  TRACE_BEGIN(TRACE_LCD_CLEAR);
+  LCD_WRITE_SLOW_CMD(lcd, 1<<LCD_CLR_bp);
+  lcd->line = 0;
+#if LCD_FRAMEBUFFER==1
+  memset(lcd->shadow, ' ', sizeof(lcd->shadow));
+  lcd->fb_valid = 1;
+  lcd->cursor_x = 0;
+  lcd->cursor_y = 0;
+#endif
+  TRACE_END(TRACE_LCD_CLEAR);
+}
+
+/*! \brief Cursor to home position.
+ *
+ *  This function sets cursor to home position.
+ *
+ *  \param  lcd       the display
+ *
+ *  \return           none
+ */
+void lcd_home(lcd_t *lcd)
+{
+  TRACE_BEGIN(TRACE_LCD_HOME);
+  LCD_WRITE_SLOW_CMD(lcd, 1<<LCD_HOME_bp);
+  lcd->line = 0;
+#if LCD_FRAMEBUFFER==1
+  lcd->cursor_x = 0;
+  lcd->cursor_y = 0;
+#endif
+  TRACE_END(TRACE_LCD_HOME);
+}
+
+#if LCD_GLYPH_CACHE==1
+
+#if LCD_FRAMEBUFFER==1
+/*
+ * Returns a bit for every CGRAM slot of which the character is in rows.
+ */
+static uint8_t lcd_glyph_used(lcd_t *lcd, char rows[][LCD_MAX_LENGTH])
+{
+  uint8_t x, y, c, used = 0;
+
+  for (y = 0; y < lcd->lines; y++) {
+    for (x = 0; x < lcd->length; x++) {
+      c = rows[y][x];
+      if ( c < LCD_GLYPH_SLOTS ) {
+        used |= 1 << c;
+      }
+    }
+  }
+  return used;
+}
+#endif
+
+/*
+ * Returns the index in glyph_lru of the least recently used slot that is
+ * not in busy, or LCD_GLYPH_SLOTS if all are.
+ */
+static uint8_t lcd_glyph_victim(lcd_t *lcd, uint8_t busy)
+{
+  uint8_t i = LCD_GLYPH_SLOTS;
+
+  while ( i-- > 0 ) {
+    if ( !(busy & (1 << lcd->glyph_lru[i])) ) {
+      return i;
+    }
+  }
+  return LCD_GLYPH_SLOTS;
+}
+
+/*! \brief Sets the glyph library of the display.
+ *
+ *  This function sets the library in flash of which lcd_glyph() takes
+ *  the glyphs, the id of a glyph is its index. The CGRAM cache is emptied.
+ *
+ *  \param  lcd       the display
+ *  \param  glyphs    array of lcd_glyph_t in flash (PROGMEM)
+ *
+ *  \return           none
+ */
+void lcd_glyph_library(lcd_t *lcd, const lcd_glyph_t *glyphs)
+{
+  lcd->glyphs = glyphs;
+  lcd_glyph_init(lcd);
+}
+
+/*! \brief Returns the character of a glyph.
+ *
+ *  This function returns the character code that shows glyph id of the
+ *  library. If the glyph is not in CGRAM it is uploaded into the least
+ *  recently used slot. With the framebuffer a slot is not taken while its
+ *  character is in the framebuffer, and preferably not while it is still
+ *  on the LCD. Uploading moves the address counter into CGRAM, without
+ *  the framebuffer call lcd_gotoxy() before writing characters.
+ *
+ *  \param  lcd       the display
+ *  \param  id        index of the glyph in the library
+ *
+ *  \return           character 0..7, LCD_GLYPH_FULL if all slots are on the screen
+ */
+char lcd_glyph(lcd_t *lcd, uint8_t id)
+{
+  uint8_t i, r, slot;
+  uint8_t wanted = 0, shown = 0;
+
+  for (i = 0; i < LCD_GLYPH_SLOTS; i++) {
+    if ( lcd->glyph_id[lcd->glyph_lru[i]] == id ) {
+      break;
+    }
+  }
+  if ( i == LCD_GLYPH_SLOTS ) {              // miss
+#if LCD_FRAMEBUFFER==1
+    wanted = lcd_glyph_used(lcd, lcd->fb);
+    if ( lcd->fb_valid ) {
+      shown = lcd_glyph_used(lcd, lcd->shadow);
+    }
+#endif
+    i = lcd_glyph_victim(lcd, wanted | shown);
+    if ( i == LCD_GLYPH_SLOTS ) {            // on the LCD until the next flush
+      i = lcd_glyph_victim(lcd, wanted);
+    }
+    if ( i == LCD_GLYPH_SLOTS ) {
+      return LCD_GLYPH_FULL;
+    }
+    slot = lcd->glyph_lru[i];
+    LCD_CURSOR_UNKNOWN(lcd);
+    LCD_WRITE_BYTE(lcd, (1<<LCD_CGRAM_bp) | (slot * LCD_GLYPH_ROWS), 0);
+    for (r = 0; r < LCD_GLYPH_ROWS; r++) {
+      LCD_WRITE_BYTE(lcd, pgm_read_byte(&lcd->glyphs[id][r]), 1);
+    }
+    lcd->glyph_id[slot] = id;
+  }
+  slot = lcd->glyph_lru[i];
+  memmove(&lcd->glyph_lru[1], &lcd->glyph_lru[0], i);
+  lcd->glyph_lru[0] = slot;
+  return slot;
+}
+
+#endif
+
+#if LCD_MARQUEE==1
+
+/*
+ * Character i of the marquee, the text is padded with spaces up to
+ * marquee_len.
+ */
+static inline char lcd_marquee_char(lcd_t *lcd, uint16_t i)
+{
+  return (i < lcd->marquee_text) ? lcd->marquee[i] : ' ';
+}
+
+/*
+ * Writes n characters of the marquee from index i on into the DDRAM line,
+ * from column col on. The address counter goes to the other line after
+ * the last column, so a wrap needs a new address.
+ */
+static void lcd_marquee_fill(lcd_t *lcd, uint8_t col, uint16_t i, uint8_t n)
+{
+  LCD_SCREEN_UNKNOWN(lcd);
+  while ( n > 0 ) {
+    LCD_WRITE_BYTE(lcd, (1<<LCD_DDRAM_bp) | (lcd->marquee_addr + col), 0);
+    do {
+      LCD_WRITE_BYTE(lcd, lcd_marquee_char(lcd, i), 1);
+      if ( ++i == lcd->marquee_len ) {
+        i = 0;
+      }
+      n--;
+    } while ( (n > 0) && (++col < LCD_DDRAM_LENGTH) );
+    col = 0;
+  }
+}
+
+/*! \brief Starts a marquee.
+ *
+ *  This function loads text into the DDRAM line of line y, so that its
+ *  first character is in the left most position. A text shorter than the
+ *  DDRAM line is padded with spaces and never loaded again. The text is
+ *  not copied, it must stay valid until lcd_marquee_stop().
+ *
+ *  \param  lcd       the display
+ *  \param  y         vertical position (0: first line)
+ *  \param  text      pointer to the character string
+ *
+ *  \return           none
+ */
+void lcd_marquee(lcd_t *lcd, uint8_t y, const char *text)
+{
+  if ( y >= lcd->lines ) {
+    y = lcd->lines - 1;
+  }
+  lcd_home(lcd);                             // display shift 0
+  lcd->marquee       = text;
+  lcd->marquee_text  = strlen(text);
+  lcd->marquee_len   = (lcd->marquee_text > LCD_DDRAM_LENGTH) ? lcd->marquee_text : LCD_DDRAM_LENGTH;
+  lcd->marquee_pos   = 0;
+  lcd->marquee_addr  = LCD_START_LINE(y & 1, 0);
+  lcd->marquee_shift = (y & 2) ? lcd->length : 0;   // lines 3 and 4 continue lines 1 and 2
+  lcd->marquee_stale = 0;
+  lcd_marquee_fill(lcd, lcd->marquee_shift, 0, LCD_DDRAM_LENGTH);
+}
+
+/*! \brief Scrolls the marquee one character to the left.
+ *
+ *  This function shifts the display one position, which is one command.
+ *  For a text longer than the DDRAM line the columns that left the view
+ *  are loaded with the text that comes next, every LCD_MARQUEE_REFILL
+ *  steps, or earlier if they would come into view. A 20x4 display shows
+ *  all 40 columns, then the column that left the view is loaded at once.
+ *
+ *  \param  lcd       the display
+ *
+ *  \return           none
+ */
+void lcd_marquee_step(lcd_t *lcd)
+{
+  uint8_t span = (lcd->lines > 2) ? 2 * lcd->length : lcd->length;   // visible columns of the DDRAM line
+  uint8_t limit = LCD_DDRAM_LENGTH - span;
+  uint8_t n;
+
+  if ( !lcd->marquee ) {
+    return;
+  }
+  LCD_WRITE_BYTE(lcd, LCD_MOVE_DISP_LEFT, 0);
+  if ( ++lcd->marquee_shift == LCD_DDRAM_LENGTH ) {
+    lcd->marquee_shift = 0;
+  }
+  if ( ++lcd->marquee_pos == lcd->marquee_len ) {
+    lcd->marquee_pos = 0;
+  }
+  if ( lcd->marquee_len == LCD_DDRAM_LENGTH ) {
+    return;                                  // the DDRAM line holds the whole period
+  }
+  if ( limit > LCD_MARQUEE_REFILL ) {
+    limit = LCD_MARQUEE_REFILL;
+  }
+  if ( ++lcd->marquee_stale < limit ) {      // a 20x4 shows all columns, then limit is 0
+    return;
+  }
+  n = lcd->marquee_stale;
+  lcd->marquee_stale = 0;
+  lcd_marquee_fill(lcd, (lcd->marquee_shift + LCD_DDRAM_LENGTH - n) % LCD_DDRAM_LENGTH,
+                   (lcd->marquee_pos + LCD_DDRAM_LENGTH - n) % lcd->marquee_len, n);
+}
+
+/*! \brief Stops the marquee.
+ *
+ *  This function returns the display shift to 0. The text stays in the
+ *  DDRAM, the next lcd_fb_flush() rewrites the whole screen.
+ *
+ *  \param  lcd       the display
+ *
+ *  \return           none
+ */
+void lcd_marquee_stop(lcd_t *lcd)
+{
+  lcd->marquee = NULL;
+  lcd_home(lcd);
+  LCD_SCREEN_UNKNOWN(lcd);
+}
+
+#endif
+
+#if LCD_TEMPLATE==1
+
+/*
+ * Copies field of the template from flash. Returns 0 if there is no such
+ * field.
+ */
+static uint8_t lcd_field_get(lcd_t *lcd, uint8_t field, lcd_field_t *f)
+{
+  const lcd_template_t *tpl = lcd->tpl;
+
+  if ( !tpl || (field >= pgm_read_byte(&tpl->count)) ) {
+    return 0;
+  }
+  memcpy_P(f, (const lcd_field_t *)pgm_read_ptr(&tpl->fields) + field, sizeof(*f));
+  if ( f->width > LCD_MAX_LENGTH ) {
+    f->width = LCD_MAX_LENGTH;
+  }
+  return f->width != 0;
+}
+
+/*
+ * Writes the width characters of buf at the position of the field, into
+ * the framebuffer if there is one.
+ */
+static void lcd_field_write(lcd_t *lcd, const lcd_field_t *f, const char *buf)
+{
+  uint8_t i;
+
+#if LCD_FRAMEBUFFER==1
+  for (i = 0; (i < f->width) && (f->x + i < lcd->length); i++) {
+    lcd->fb[(f->y < lcd->lines) ? f->y : lcd->lines-1][f->x + i] = buf[i];
   }
 #else
-  if ( y==0 )
-    address = LCD_START_LINE1;
-  } else if ( y==1)
-    address = LCD_START_LINE2;
-  } else if ( y==2)
-    address = LCD_START_LINE3;
-  } else {
-    address = LCD_START_LINE4;
+  lcd_gotoxy(lcd, f->x, f->y);
+  for (i = 0; i < f->width; i++) {
+    LCD_WRITE_BYTE(lcd, buf[i], 1);
   }
 #endif
+}
 
-  LCD_WRITE_BYTE((1<<LCD_DDRAM_bp) | (address + x), 0);
+/*! \brief Draws a screen template.
+ *
+ *  This function clears the screen and writes the layout of the template.
+ *  The fields keep the characters of the layout until they are written.
+ *  With the framebuffer the screen is sent by the next lcd_fb_flush().
+ *
+ *  \param  lcd       the display
+ *  \param  tpl       pointer to the template in flash
+ *
+ *  \return           none
+ */
+void lcd_template(lcd_t *lcd, const lcd_template_t *tpl)
+{
+  lcd->tpl = tpl;
+#if LCD_FRAMEBUFFER==1
+  lcd_fb_clear(lcd);
+  lcd_fb_puts_P(lcd, (const char *)pgm_read_ptr(&tpl->layout));
+#else
+  lcd_clear(lcd);
+  lcd_puts_P(lcd, (const char *)pgm_read_ptr(&tpl->layout));
+#endif
 }
 
-/*! \brief Clear lcd.
+/*! \brief Writes a number into a field of the template.
  *
- *  This function clears the LCD and sets cursor to home position.
+ *  This function writes value right aligned into the field, decimal with
+ *  spaces or hexadecimal with zeros in front, by the radix of the field.
+ *  A hexadecimal field shows value as unsigned. If the number does not
+ *  fit, the field is filled with LCD_FIELD_OVERFLOW.
+ *
+ *  \param  lcd       the display
+ *  \param  field     index of the field in the template
+ *  \param  value     the number
+ *
+ *  \return           none
+ */
+void lcd_field_num(lcd_t *lcd, uint8_t field, int16_t value)
+{
+  lcd_field_t f;
+  char buf[LCD_MAX_LENGTH];
+  uint8_t radix, neg, i, d;
+  uint16_t u = value;
+
+  if ( !lcd_field_get(lcd, field, &f) ) {
+    return;
+  }
+  radix = (f.radix == 16) ? 16 : 10;
+  neg = (radix == 10) && (value < 0);
+  if ( neg ) {
+    u = -u;
+  }
+  memset(buf, (radix == 16) ? '0' : ' ', f.width);
+  i = f.width;
+  do {
+    d = u % radix;
+    buf[--i] = (d < 10) ? '0' + d : 'a' - 10 + d;
+    u /= radix;
+  } while ( u && i );
+  if ( neg ) {
+    if ( i ) {
+      buf[--i] = '-';
+    } else {
+      u = 1;                                 // no room for the sign
+    }
+  }
+  if ( u ) {
+    memset(buf, LCD_FIELD_OVERFLOW, f.width);
+  }
+  lcd_field_write(lcd, &f, buf);
+}
+
+/*! \brief Writes a text into a field of the template.
+ *
+ *  This function writes s left aligned into the field. A shorter text is
+ *  padded with spaces, a longer text is cut off.
+ *
+ *  \param  lcd       the display
+ *  \param  field     index of the field in the template
+ *  \param  s         pointer to the character string
  *
  *  \return           none
  */
-void lcd_clear(void)
+void lcd_field_text(lcd_t *lcd, uint8_t field, const char *s)
 {
-  lcd_cmd(1<<LCD_CLR_bp);
-  lcd_line = 0;
-  _delay_us(T_CLEARDISPLAY_us);
+  lcd_field_t f;
+  char buf[LCD_MAX_LENGTH];
+  uint8_t i;
+
+  if ( !lcd_field_get(lcd, field, &f) ) {
+    return;
+  }
+  for (i = 0; i < f.width; i++) {
+    buf[i] = *s ? *s++ : ' ';
+  }
+  lcd_field_write(lcd, &f, buf);
 }
 
-/*! \brief Cursor to home position.
+#endif
+
+#if LCD_QUEUE==1
+
+/*! \brief Puts a byte in the write queue.
  *
- *  This function sets cursor to home position.
+ *  This function puts a byte in the write queue of the display and returns
+ *  immediately. If the queue is full it waits until there is room for the
+ *  byte. If the display is idle the byte is sent at once.
+ *
+ *  \param  lcd       the display
+ *  \param  b         the byte
+ *  \param  flags     LCD_QUEUE_RS for data, LCD_QUEUE_SLOW for clear and home
  *
  *  \return           none
  */
-void lcd_home(void)
+void lcd_enqueue(lcd_t *lcd, uint8_t b, uint8_t flags)
 {
-  lcd_cmd(1<<LCD_HOME_bp);
-  lcd_line = 0;
-  _delay_us(T_CLEARDISPLAY_us);
+  uint8_t head = lcd->queue_head;
+  uint8_t next = (head + 1) & (LCD_QUEUE_SIZE - 1);
+  uint8_t sreg;
+
+  TRACE_BEGIN(TRACE_LCD_BYTE);
+  while ( next == lcd->queue_tail ) {         // queue is full
+    lcd_queue_poll();
+  }
+  lcd->queue_data[head]  = b;
+  lcd->queue_flags[head] = flags;
+  lcd->queue_head = next;
+
+  if ( !lcd->busy ) {                         // else the interrupt comes when it is ready
+    sreg = SREG;
+    cli();
+    lcd_queue_run();
+    SREG = sreg;
+  }
+  TRACE_END(TRACE_LCD_BYTE);
 }
+
+/*! \brief Checks if all queued bytes are written.
+ *
+ *  This function checks if the write queue of the display is empty and
+ *  the display has executed the last byte.
+ *
+ *  \param  lcd       the display
+ *
+ *  \return           1 if the LCD is idle, 0 if not
+ */
+uint8_t lcd_idle(lcd_t *lcd)
+{
+  lcd_queue_poll();
+  return (lcd->queue_tail == lcd->queue_head) && !lcd->busy;
+}
+
+/*! \brief Waits until all queued bytes are written.
+ *
+ *  This function waits until the write queue of the display is empty and
+ *  the display has executed the last byte.
+ *
+ *  \param  lcd       the display
+ *
+ *  \return           none
+ */
+void lcd_flush(lcd_t *lcd)
+{
+  while ( !lcd_idle(lcd) ) ;
+}
+
+#endif
+
+#if LCD_FRAMEBUFFER==1
+
+/*! \brief Clear the framebuffer.
+ *
+ *  This function fills the framebuffer with spaces and sets the write
+ *  position to the home position. Nothing is sent to the LCD until
+ *  lcd_fb_flush() is called.
+ *
+ *  \param  lcd       the display
+ *
+ *  \return           none
+ */
+void lcd_fb_clear(lcd_t *lcd)
+{
+  memset(lcd->fb, ' ', sizeof(lcd->fb));
+  lcd->fb_x = 0;
+  lcd->fb_y = 0;
+}
+
+/*! \brief Set write position in the framebuffer.
+ *
+ *  This function sets the position where the next character is written
+ *  in the framebuffer.
+ *
+ *  \param  lcd       the display
+ *  \param  x         horizontal position (0: left most position)
+ *  \param  y         vertical   position (0: first line)
+ *
+ *  \return           none
+ */
+void lcd_fb_gotoxy(lcd_t *lcd, uint8_t x, uint8_t y)
+{
+  lcd->fb_x = x;
+  lcd->fb_y = (y < lcd->lines) ? y : lcd->lines-1;
+}
+
+/*! \brief Writes a character to the framebuffer.
+ *
+ *  This function writes a character to the framebuffer.
+ *  The characters '\\n' and '\\f' have the same meaning as for lcd_putc().
+ *  Characters beyond the end of a line are discarded.
+ *
+ *  \param  lcd       the display
+ *  \param  c         the character to be written
+ *
+ *  \return           none
+ */
+void lcd_fb_putc(lcd_t *lcd, char c)
+{
+  switch (c) {
+    case '\f':
+      lcd_fb_clear(lcd);
+      break;
+    case '\n':
+      if (++lcd->fb_y==lcd->lines) lcd->fb_y = 0;
+      lcd->fb_x = 0;
+      break;
+    default:
+      if (lcd->fb_x < lcd->length) {
+        lcd->fb[lcd->fb_y][lcd->fb_x++] = c;
+      }
+      break;
+  }
+}
+
+/*! \brief Writes a string to the framebuffer.
+ *
+ *  This function writes a character string to the framebuffer.
+ *
+ *  \param  lcd       the display
+ *  \param  s         pointer to the character string
+ *
+ *  \return           none
+ */
+void lcd_fb_puts(lcd_t *lcd, const char *s)
+{
+  char c;
+
+  while ( (c = *s++) ) {
+    lcd_fb_putc(lcd, c);
+  }
+}
+
+/*! \brief Writes a string from flash to the framebuffer.
+ *
+ *  This function writes a character string that is in flash, e.g. made
+ *  with PSTR(), to the framebuffer.
+ *
+ *  \param  lcd       the display
+ *  \param  s         pointer to the character string in flash
+ *
+ *  \return           none
+ */
+void lcd_fb_puts_P(lcd_t *lcd, const char *s)
+{
+  char c;
+
+  while ( (c = pgm_read_byte(s++)) ) {
+    lcd_fb_putc(lcd, c);
+  }
+}
+
+#if LCD_GLYPH_CACHE==1
+/*! \brief Writes a glyph to the framebuffer.
+ *
+ *  This function writes the character of glyph id, see lcd_glyph(), at
+ *  the write position of the framebuffer. The glyph that was there does
+ *  not keep its CGRAM slot.
+ *
+ *  \param  lcd       the display
+ *  \param  id        index of the glyph in the library
+ *
+ *  \return           none
+ */
+void lcd_fb_glyph(lcd_t *lcd, uint8_t id)
+{
+  if (lcd->fb_x < lcd->length) {
+    lcd->fb[lcd->fb_y][lcd->fb_x] = ' ';
+    lcd->fb[lcd->fb_y][lcd->fb_x++] = lcd_glyph(lcd, id);
+  }
+}
+#endif
+
+/*! \brief Forces a complete rewrite at the next flush.
+ *
+ *  This function must be called when the contents of the LCD are changed
+ *  in a way the driver can not follow, e.g. after a reset of the display.
+ *  Writes with lcd_putc(), lcd_data() and lcd_cmd() are detected by the
+ *  driver itself.
+ *
+ *  \param  lcd       the display
+ *
+ *  \return           none
+ */
+void lcd_fb_invalidate(lcd_t *lcd)
+{
+  lcd->fb_valid = 0;
+  lcd->cursor_x = 0xFF;
+}
+
+/*! \brief Sends the changes in the framebuffer to the LCD.
+ *
+ *  This function compares the framebuffer with the characters that are
+ *  on the LCD and writes only the characters that differ. The cursor is
+ *  only moved with lcd_gotoxy() at the start of a run of changed
+ *  characters, within a run the auto increment of the LCD is used.
+ *
+ *  \param  lcd       the display
+ *
+ *  \return           none
+ */
+void lcd_fb_flush(lcd_t *lcd)
+{
+  uint8_t x, y;
+  char c;
+
+  for (y = 0; y < lcd->lines; y++) {
+    for (x = 0; x < lcd->length; x++) {
+      c = lcd->fb[y][x];
+      if ( lcd->fb_valid && (lcd->shadow[y][x] == c) ) {
+        continue;
+      }
+      if ( (lcd->cursor_x != x) || (lcd->cursor_y != y) ) {
+        lcd_gotoxy(lcd, x, y);
+        lcd->cursor_y = y;
+      }
+      LCD_WRITE_BYTE(lcd, c, 1);
+      lcd->shadow[y][x] = c;
+      lcd->cursor_x = x + 1;
+    }
+  }
+  lcd->fb_valid = 1;
+}
+
+#endif
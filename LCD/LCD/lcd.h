@@ -21,7 +21,15 @@
  *
  *           There are defines for these four modes:
  *           - LCD_4BIT_MODE     1 is 4 bit mode, 0 is 8 bit mode
- *           - LCD_BUSY_FLAG     1 is with busyflag, 0 is without busyflag
+ *           - LCD_BUSY_FLAG     1 is with busyflag, 0 is without busyflag,
+ *                               2 is busyflag only used by lcd_init()
+ *
+ *           With the busyflag lcd_init() measures the execution time of the
+ *           commands. With LCD_BUSY_FLAG 2 these measured times are used
+ *           instead of the fixed times TDELAY_us and T_CLEARDISPLAY_us.
+ *           Waiting for the busyflag stops after LCD_BUSY_TIMEOUT_us. The
+ *           driver then uses the fixed times and lcd_status() returns
+ *           LCD_FAULT_BUSY_bm.
  *
  *           In 8 bit mode all 8 data pins must be connected to one 8-pin port of
  *           the Xmega.
@@ -33,27 +41,121 @@
  *           The control lines RS, E and R/W can connected to any pin of any port
  *           of the Xmega.
  *
+ *           Several displays can share the data lines, RS and R/W, every display
+ *           has its own E line. Each display is described by an lcd_t that the
+ *           application provides and that is passed to every lcd_... function.
+ *           lcd_init() sets its E line and its geometry: 16 or 20 characters on
+ *           1, 2 or 4 lines. Initialize all displays before writing to any of
+ *           them, the bus is not shared with an initialization in progress.
+ *
+ *           With LCD_FRAMEBUFFER 1 the driver keeps a copy of the visible DDRAM
+ *           in RAM. The lcd_fb_... functions write into that copy and
+ *           lcd_fb_flush() only sends the characters that have changed.
+ *
+ *           With LCD_GLYPH_CACHE 1 the 8 CGRAM characters are a cache for a
+ *           library of glyphs in flash. lcd_glyph() returns the character of a
+ *           glyph and uploads it only when it is not in CGRAM, into the least
+ *           recently used slot. With the framebuffer a slot that is used on the
+ *           screen is not given to another glyph, so the screen stays correct.
+ *
+ *           With LCD_MARQUEE 1 lcd_marquee() scrolls a text through one line
+ *           with the display shift: the text is loaded into the 40 characters
+ *           of the DDRAM line once, every lcd_marquee_step() is one command.
+ *           A longer text is reloaded in the columns that are out of view.
+ *           The shift moves all lines of the display. On a 4 line display lines
+ *           1 and 3, and 2 and 4, share a DDRAM line: the other one shows the
+ *           text that follows.
+ *
+ *           With LCD_TEMPLATE 1 a screen is a template in flash: a layout text
+ *           with the fixed labels and a table of fields. lcd_template() draws
+ *           the layout once, lcd_field_num() and lcd_field_text() then only
+ *           rewrite a field at its fixed position. With the framebuffer they
+ *           write into the framebuffer, so lcd_fb_flush() only sends the
+ *           characters of a field that changed.
+ *
+ *           With LCD_QUEUE 1 the lcd_... functions do not wait for the LCD, but
+ *           put the bytes in a queue of the display. The compare interrupt of
+ *           LCD_TC sends the next byte of a queue after the execution time of
+ *           the previous byte for that display. Meanwhile the bus is free for
+ *           the other displays, so with more displays more bytes per second are
+ *           written. This mode can only be combined with LCD_BUSY_FLAG 2.
+ *           lcd_init() enables the low level interrupts, the application must
+ *           enable the global interrupts with sei().
+ *
+ *           With LCD_FAST_IO 1 the data port and the communication port are
+ *           mapped on the virtual ports LCD_DATA_VPORT and LCD_COMM_VPORT, so
+ *           setting RS and R/W compiles to single cycle sbi/cbi instructions.
+ *           The mask of E is only known at run time, E stays a store to OUTSET
+ *           and OUTCLR of its port, which is atomic. RS and R/W must then be
+ *           connected to LCD_COMM_PORT and no other code may use the virtual
+ *           ports 0 and 1. Writing a nibble is a read-modify-write of the
+ *           virtual port, so an interrupt must not change other pins of
+ *           LCD_DATA_PORT.
+ *
  *           \warning
  *           Be careful using the busyflag. Most alfanumeric displays are 5 Volt devices.
  *           The Xmega is not 5 Volt tolerant.
  *           When using the busyflag, information is also send from the LCD to the
  *           Xmega. So you can damage your Xmega.
  */
+#ifndef LCD_H_
+#define LCD_H_
+
+#include <avr/io.h>
+#include <stdint.h>
 /*!
- *  \brief F_CPU must be declared
+ *  \brief F_CPU is declared by the clock module
  */
-#ifndef F_CPU
-#define F_CPU             2000000UL
-#endif
+#include "clock.h"
 
 /*!
  *  \brief Macro defining the 4-bit mode (1) or the 8-bit mode (0)
  */
+#ifndef LCD_4BIT_MODE
 #define LCD_4BIT_MODE     1
+#endif
 /*!
- *  \brief Macro defining that you want to use the busy flag (1) or not (0)
+ *  \brief Macro defining that you want to use the busy flag (1), only for calibration (2) or not (0)
  */
+#ifndef LCD_BUSY_FLAG
 #define LCD_BUSY_FLAG     0
+#endif
+/*!
+ *  \brief Macro defining that you want to use the shadow framebuffer (1) or not (0)
+ */
+#ifndef LCD_FRAMEBUFFER
+#define LCD_FRAMEBUFFER   1
+#endif
+/*!
+ *  \brief Macro defining that the CGRAM is a cache for a glyph library (1) or not (0)
+ */
+#ifndef LCD_GLYPH_CACHE
+#define LCD_GLYPH_CACHE   1
+#endif
+/*!
+ *  \brief Macro defining that lcd_marquee() scrolls with the display shift (1) or not (0)
+ */
+#ifndef LCD_MARQUEE
+#define LCD_MARQUEE       1
+#endif
+/*!
+ *  \brief Macro defining that screen templates with fields are used (1) or not (0)
+ */
+#ifndef LCD_TEMPLATE
+#define LCD_TEMPLATE      1
+#endif
+/*!
+ *  \brief Macro defining that writes are queued and sent by a timer interrupt (1) or not (0)
+ */
+#ifndef LCD_QUEUE
+#define LCD_QUEUE         1
+#endif
+/*!
+ *  \brief Macro defining that the hot paths use the virtual ports (1) or not (0)
+ */
+#ifndef LCD_FAST_IO
+#define LCD_FAST_IO       0
+#endif
 
 /*!
  *  \brief Macro's to define the data port
@@ -67,14 +169,33 @@
 #define LCD_D5_PORT       LCD_DATA_PORT  //!< Port D5-pin  (currently not used)
 #define LCD_D6_PORT       LCD_DATA_PORT  //!< Port D6-pin  (currently not used)
 #define LCD_D7_PORT       LCD_DATA_PORT  //!< Port D7-pin  (currently not used)
+/*!
+ *  \brief Bit positions of the data pins, may be set on the command line
+ */
+#ifndef LCD_D0_bp
 #define LCD_D0_bp         PIN0_bp        //!< Bit position D0-pin (currently not used)
+#endif
+#ifndef LCD_D1_bp
 #define LCD_D1_bp         PIN1_bp        //!< Bit position D1-pin (currently not used)
+#endif
+#ifndef LCD_D2_bp
 #define LCD_D2_bp         PIN2_bp        //!< Bit position D2-pin (currently not used)
+#endif
+#ifndef LCD_D3_bp
 #define LCD_D3_bp         PIN3_bp        //!< Bit position D3-pin (currently not used)
+#endif
+#ifndef LCD_D4_bp
 #define LCD_D4_bp         PIN4_bp        //!< Bit position D4-pin
+#endif
+#ifndef LCD_D5_bp
 #define LCD_D5_bp         PIN5_bp        //!< Bit position D5-pin
+#endif
+#ifndef LCD_D6_bp
 #define LCD_D6_bp         PIN6_bp        //!< Bit position D6-pin
+#endif
+#ifndef LCD_D7_bp
 #define LCD_D7_bp         PIN7_bp        //!< Bit position D7-pin
+#endif
 
 /*!
  *  \brief Macro's to define the communication port
@@ -82,10 +203,18 @@
 #define LCD_COMM_PORT     PORTD
 #define LCD_RS_PORT       LCD_COMM_PORT  //!< Port RS-pin
 #define LCD_RW_PORT       LCD_COMM_PORT  //!< Port R/W-pin
-#define LCD_E_PORT        LCD_COMM_PORT  //!< Port E-pin
+#define LCD_E_PORT        LCD_COMM_PORT  //!< Port E-pin of the first display
 #define LCD_RS_bp         PIN4_bp        //!< Bit position RS-pin
 #define LCD_RW_bp         PIN3_bp        //!< Bit position R/W-pin
-#define LCD_E_bp          PIN5_bp        //!< Bit position E-pin
+#define LCD_E_bp          PIN5_bp        //!< Bit position E-pin of the first display
+
+/*!
+ *  \brief Macro's to define the virtual ports for LCD_FAST_IO
+ */
+#define LCD_DATA_VPORT    VPORT0                      //!< Virtual port of LCD_DATA_PORT
+#define LCD_DATA_VPMAP    PORTCFG_VP0MAP_PORTA_gc     //!< Maps LCD_DATA_PORT on LCD_DATA_VPORT
+#define LCD_COMM_VPORT    VPORT1                      //!< Virtual port of LCD_COMM_PORT
+#define LCD_COMM_VPMAP    PORTCFG_VP1MAP_PORTD_gc     //!< Maps LCD_COMM_PORT on LCD_COMM_VPORT
 
 #define TDELAY1_ms        50             //!< Time Delay 1st initialization
 #define TDELAY2_ms        5              //!< Time Delay 2nd initialization
@@ -93,21 +222,41 @@
 #define TPWE_us           0.5            //!< Time Period Width Enable (TpwE)
 #define TDELAY_us         50             //!< Time Delay commands and data
 #define T_CLEARDISPLAY_us 1600           //!< Time Delay clear display
+#define LCD_BUSY_TIMEOUT_us 5000         //!< Maximum time waiting for the busy flag
 
-#define LCD_LINES          2             //!< Number of visible lines of the display
-#define LCD_DISP_LENGTH    16            //!< Visible characters per line of the display
+#define LCD_QUEUE_SIZE    32             //!< Number of bytes in the write queue (power of 2)
+#define LCD_TC            TCD1           //!< Timer/counter for write queue and busy flag timing
+#define LCD_TC_CCA_vect   TCD1_CCA_vect  //!< Compare A interrupt vector of LCD_TC
+#define LCD_TC_CLKSEL     TC_CLKSEL_DIV8_gc  //!< Clock selection LCD_TC
+#define LCD_TC_DIV        8              //!< Prescaler LCD_TC (must match LCD_TC_CLKSEL)
+
+#define LCD_FAULT_BUSY_bm  0x01          //!< lcd_status(): busy flag timed out
+
+#define LCD_GLYPH_SLOTS    8             //!< Characters in CGRAM (5x8 font)
+#define LCD_GLYPH_ROWS     8             //!< Bytes of a glyph, one per row, bits 4..0
+#define LCD_GLYPH_NONE     0xFF          //!< Glyph id of a free CGRAM slot
+#define LCD_GLYPH_FULL     '*'           //!< lcd_glyph(): all slots are on the screen
+
+#define LCD_DDRAM_LENGTH   40            //!< Characters of a DDRAM line in 2 line mode
+#define LCD_MARQUEE_REFILL 8             //!< Marquee steps between reloads of a long text
+
+#define LCD_FIELD_TEXT     0             //!< lcd_field_t radix of a text field
+#define LCD_FIELD_OVERFLOW '#'           //!< Fills a numeric field that is too small
+
+#define LCD_MAX_LINES      4             //!< Most visible lines of a display (framebuffer size)
+#define LCD_MAX_LENGTH     20            //!< Most visible characters per line (framebuffer size)
 
-#if LCD_DISP_LENGTH==16
-#define LCD_START_LINE1    0x00          //!< DDRAM address of first char of line 1
-#define LCD_START_LINE2    0x40          //!< DDRAM address of first char of line 2
-#define LCD_START_LINE3    0x10          //!< DDRAM address of first char of line 3
-#define LCD_START_LINE4    0x50          //!< DDRAM address of first char of line 4
-#else
 #define LCD_START_LINE1    0x00          //!< DDRAM address of first char of line 1
 #define LCD_START_LINE2    0x40          //!< DDRAM address of first char of line 2
-#define LCD_START_LINE3    0x14          //!< DDRAM address of first char of line 3
-#define LCD_START_LINE4    0x54          //!< DDRAM address of first char of line 4
-#endif
+
+/*! \def LCD_START_LINE(y,length)
+ *  \brief DDRAM address of first char of line y (0..3)
+ *
+ *  A 4 line display is a 2 line controller with each line folded in two:
+ *  lines 3 and 4 continue lines 1 and 2 after length characters, at 0x10
+ *  and 0x50 for 16 characters and at 0x14 and 0x54 for 20 characters.
+ */
+#define LCD_START_LINE(y,length) ((((y) & 1) ? LCD_START_LINE2 : LCD_START_LINE1) + (((y) & 2) ? (length) : 0))
 
 #define LCD_CLR_bp               0      //!< DB0: clear display
 #define LCD_HOME_bp              1      //!< DB1: return to home position
@@ -152,14 +301,133 @@
 #define LCD_FUNCTION_8BIT_1LINE  0x30   //!< 8-bit, single line, 5x8 dots
 #define LCD_FUNCTION_8BIT_2LINES 0x38   //!< 8-bit, dual line,   5x8 dots
 
-void lcd_init(void);
-void lcd_clear(void);
-void lcd_home(void);
-void lcd_gotoxy(uint8_t x, uint8_t y);
-void lcd_putc(char c);
-void lcd_puts(char *s);
-void lcd_cmd(uint8_t cmd);
-void lcd_data(uint8_t b);
+/*! \brief Glyph of the library: 8 rows of 5 pixels, top row first
+ */
+typedef uint8_t lcd_glyph_t[LCD_GLYPH_ROWS];
+
+/*! \brief Field of a screen template
+ *
+ *  Numeric fields are right aligned, decimal with spaces and hexadecimal
+ *  with zeros in front. Text fields are left aligned.
+ */
+typedef struct {
+  uint8_t  x;                        //!< horizontal position of the first character
+  uint8_t  y;                        //!< vertical position
+  uint8_t  width;                    //!< characters, at most LCD_MAX_LENGTH
+  uint8_t  radix;                    //!< 10 or 16 for a number, LCD_FIELD_TEXT for text
+} lcd_field_t;
+
+/*! \brief Screen template, in flash with its layout and fields
+ */
+typedef struct {
+  const char        *layout;         //!< fixed text in flash, '\n' starts the next line
+  const lcd_field_t *fields;         //!< fields in flash, the index is the field id
+  uint8_t            count;          //!< number of fields
+} lcd_template_t;
+
+/*! \brief Descriptor of one display
+ *
+ *  The application provides the storage, lcd_init() fills it in. The
+ *  fields are used by the driver and its interrupt only.
+ */
+typedef struct lcd_struct {
+  PORT_t  *e_port;                   //!< port of the E line
+  uint8_t  e_bm;                     //!< bit mask of the E line
+  uint8_t  lines;                    //!< visible lines (1, 2 or 4)
+  uint8_t  length;                   //!< visible characters per line
+  uint8_t  line;                     //!< current line of lcd_putc() (0 is first line)
+  uint8_t  fault;                    //!< LCD_FAULT_..._bm flags, see lcd_status()
+#if LCD_BUSY_FLAG!=0 || LCD_QUEUE==1
+  uint16_t tdelay;                   //!< execution time commands and data in ticks of LCD_TC
+  uint16_t tclear;                   //!< execution time clear and home in ticks of LCD_TC
+#endif
+#if LCD_BUSY_FLAG!=0
+  uint16_t fallback;                 //!< wait before the next write without busy flag
+#endif
+#if LCD_QUEUE==1
+  volatile uint8_t queue_data[LCD_QUEUE_SIZE];
+  volatile uint8_t queue_flags[LCD_QUEUE_SIZE];
+  volatile uint8_t queue_head;       //!< next free entry, only changed by lcd_enqueue()
+  volatile uint8_t queue_tail;       //!< next entry to send, only changed by the interrupt
+  volatile uint8_t busy;             //!< 1 while the last byte sent is executed
+  uint16_t ready;                    //!< LCD_TC count at which that byte is executed
+  struct lcd_struct *next;           //!< next display served by the interrupt
+#endif
+#if LCD_GLYPH_CACHE==1
+  const lcd_glyph_t *glyphs;         //!< glyph library in flash, see lcd_glyph_library()
+  uint8_t  glyph_id[LCD_GLYPH_SLOTS];   //!< glyph in each CGRAM slot or LCD_GLYPH_NONE
+  uint8_t  glyph_lru[LCD_GLYPH_SLOTS];  //!< CGRAM slots, most recently used first
+#endif
+#if LCD_MARQUEE==1
+  const char *marquee;               //!< text of the marquee, NULL if none
+  uint16_t marquee_text;             //!< characters in the text
+  uint16_t marquee_len;              //!< period of the marquee, at least LCD_DDRAM_LENGTH
+  uint16_t marquee_pos;              //!< index in the text of the left most visible char
+  uint8_t  marquee_addr;             //!< DDRAM address of the line at display shift 0
+  uint8_t  marquee_shift;            //!< DDRAM column of the left most visible char
+  uint8_t  marquee_stale;            //!< columns out of view that hold old text
+#endif
+#if LCD_TEMPLATE==1
+  const lcd_template_t *tpl;         //!< template in flash drawn by lcd_template()
+#endif
+#if LCD_FRAMEBUFFER==1
+  char     fb[LCD_MAX_LINES][LCD_MAX_LENGTH];      //!< contents wanted by the application
+  char     shadow[LCD_MAX_LINES][LCD_MAX_LENGTH];  //!< contents last sent to the lcd
+  uint8_t  fb_valid;                 //!< 1 if shadow equals the contents of the lcd
+  uint8_t  fb_x;                     //!< write position in fb
+  uint8_t  fb_y;
+  uint8_t  cursor_x;                 //!< position of the lcd cursor, 0xFF is unknown
+  uint8_t  cursor_y;
+#endif
+} lcd_t;
+
+void lcd_init(lcd_t *lcd, PORT_t *e_port, uint8_t e_bp, uint8_t lines, uint8_t length);
+void lcd_clear(lcd_t *lcd);
+void lcd_home(lcd_t *lcd);
+void lcd_gotoxy(lcd_t *lcd, uint8_t x, uint8_t y);
+void lcd_putc(lcd_t *lcd, char c);
+void lcd_puts(lcd_t *lcd, const char *s);
+void lcd_puts_P(lcd_t *lcd, const char *s);
+void lcd_cmd(lcd_t *lcd, uint8_t cmd);
+void lcd_data(lcd_t *lcd, uint8_t b);
+uint8_t lcd_status(lcd_t *lcd);
+uint16_t lcd_exec_time_us(lcd_t *lcd, uint8_t slow);
+
+#if LCD_GLYPH_CACHE==1
+void lcd_glyph_library(lcd_t *lcd, const lcd_glyph_t *glyphs);
+char lcd_glyph(lcd_t *lcd, uint8_t id);
+#endif
+
+#if LCD_MARQUEE==1
+void lcd_marquee(lcd_t *lcd, uint8_t y, const char *text);
+void lcd_marquee_step(lcd_t *lcd);
+void lcd_marquee_stop(lcd_t *lcd);
+#endif
+
+#if LCD_TEMPLATE==1
+void lcd_template(lcd_t *lcd, const lcd_template_t *tpl);
+void lcd_field_num(lcd_t *lcd, uint8_t field, int16_t value);
+void lcd_field_text(lcd_t *lcd, uint8_t field, const char *s);
+#endif
+
+#if LCD_QUEUE==1
+uint8_t lcd_idle(lcd_t *lcd);
+void lcd_flush(lcd_t *lcd);
+void lcd_enqueue(lcd_t *lcd, uint8_t b, uint8_t flags);
+#endif
+
+#if LCD_FRAMEBUFFER==1
+void lcd_fb_clear(lcd_t *lcd);
+void lcd_fb_gotoxy(lcd_t *lcd, uint8_t x, uint8_t y);
+void lcd_fb_putc(lcd_t *lcd, char c);
+void lcd_fb_puts(lcd_t *lcd, const char *s);
+void lcd_fb_puts_P(lcd_t *lcd, const char *s);
+void lcd_fb_flush(lcd_t *lcd);
+void lcd_fb_invalidate(lcd_t *lcd);
+#if LCD_GLYPH_CACHE==1
+void lcd_fb_glyph(lcd_t *lcd, uint8_t id);
+#endif
+#endif
 
 #define LCD_D0_bm   (1  << (LCD_D0_bp))   //!< Bit mask D0-pin
 #define LCD_D1_bm   (1  << (LCD_D1_bp))   //!< Bbit mask D1-pin
@@ -171,16 +439,17 @@ void lcd_data(uint8_t b);
 #define LCD_D7_bm   (1  << (LCD_D7_bp))   //!< Bit mask D7-pin
 #define LCD_RS_bm   (1  << (LCD_RS_bp))   //!< Bit mask RS-pin
 #define LCD_RW_bm   (1  << (LCD_RW_bp))   //!< Bit mask R/W-pin
-#define LCD_E_bm    (1  << (LCD_E_bp))    //!< Bit mask E-pin
+#define LCD_E_bm    (1  << (LCD_E_bp))    //!< Bit mask E-pin of the first display
 
 /*! \def LCD_DATA_PORT_gm
  *  \brief Group mask for data port
 */
-/*! \def LCD_WRITE_BYTE(b,rs)
+/*! \def LCD_WRITE_BYTE(lcd,b,rs)
  *  \brief Writes byte tot LCD
  *
  *  This function writes a byte to the LCD.
  *
+ *  \param  lcd     the display
  *  \param  b       the byte
  *  \param  rs      register select (0 is coomand, 1 is data)
  *
@@ -188,26 +457,66 @@ void lcd_data(uint8_t b);
 /*! \def LCD_INIT
  *  \brief Initalizes LCD
  */
+/*! \def LCD_OUT_BYTE(lcd,b,rs)
+ *  \brief Writes byte to LCD without waiting for the execution time
+ */
 
 #if LCD_BUSY_FLAG==1
 #if LCD_4BIT_MODE==1
 #define LCD_DATA_PORT_gm         ((LCD_D7_bm)|(LCD_D6_bm)|(LCD_D5_bm)|(LCD_D4_bm))
-#define LCD_WRITE_BYTE(b,rs)     (lcd4bf_write_byte((b),(rs)))
+#define LCD_WRITE_BYTE(lcd,b,rs) (lcd4bf_write_byte((lcd),(b),(rs)))
+#define LCD_OUT_BYTE(lcd,b,rs)   (lcd4_out_byte((lcd),(b),(rs)))
+#define LCD_INIT                 lcd4bf_init
+#else
+#define LCD_DATA_PORT_gm         (0xFF)
+#define LCD_WRITE_BYTE(lcd,b,rs) (lcd8bf_write_byte((lcd),(b),(rs)))
+#define LCD_OUT_BYTE(lcd,b,rs)   (lcd8_out_byte((lcd),(b),(rs)))
+#define LCD_INIT                 lcd8bf_init
+#endif
+#elif LCD_BUSY_FLAG==2
+#if LCD_4BIT_MODE==1
+#define LCD_DATA_PORT_gm         ((LCD_D7_bm)|(LCD_D6_bm)|(LCD_D5_bm)|(LCD_D4_bm))
+#define LCD_WRITE_BYTE(lcd,b,rs) (lcd4_write_byte((lcd),(b),(rs)))
+#define LCD_OUT_BYTE(lcd,b,rs)   (lcd4_out_byte((lcd),(b),(rs)))
 #define LCD_INIT                 lcd4bf_init
 #else
 #define LCD_DATA_PORT_gm         (0xFF)
-#define LCD_WRITE_BYTE(b,rs)     (lcd8bf_write_byte((b),(rs)))
+#define LCD_WRITE_BYTE(lcd,b,rs) (lcd8_write_byte((lcd),(b),(rs)))
+#define LCD_OUT_BYTE(lcd,b,rs)   (lcd8_out_byte((lcd),(b),(rs)))
 #define LCD_INIT                 lcd8bf_init
 #endif
 #else
 #if LCD_4BIT_MODE==1
 #define LCD_DATA_PORT_gm         ((LCD_D7_bm)|(LCD_D6_bm)|(LCD_D5_bm)|(LCD_D4_bm))
-#define LCD_WRITE_BYTE(b,rs)     (lcd4_write_byte((b),(rs)))
+#define LCD_WRITE_BYTE(lcd,b,rs) (lcd4_write_byte((lcd),(b),(rs)))
+#define LCD_OUT_BYTE(lcd,b,rs)   (lcd4_out_byte((lcd),(b),(rs)))
 #define LCD_INIT                 lcd4_init
 #else
 #define LCD_DATA_PORT_gm         (0xFF)
-#define LCD_WRITE_BYTE(b,rs)     (lcd8_write_byte((b),(rs)))
+#define LCD_WRITE_BYTE(lcd,b,rs) (lcd8_write_byte((lcd),(b),(rs)))
+#define LCD_OUT_BYTE(lcd,b,rs)   (lcd8_out_byte((lcd),(b),(rs)))
 #define LCD_INIT                 lcd8_init
 #endif
 #endif
 
+/*! \def LCD_QUEUE_RS
+ *  \brief Queue flag: the byte is data (register select high)
+ */
+/*! \def LCD_QUEUE_SLOW
+ *  \brief Queue flag: the command needs T_CLEARDISPLAY_us (clear and home)
+ */
+#define LCD_QUEUE_RS             0x01
+#define LCD_QUEUE_SLOW           0x02
+
+#if LCD_QUEUE==1
+#if LCD_BUSY_FLAG==1
+#error "LCD_QUEUE can not be used with LCD_BUSY_FLAG 1"
+#endif
+#if (LCD_QUEUE_SIZE & (LCD_QUEUE_SIZE-1)) != 0
+#error "LCD_QUEUE_SIZE must be a power of 2"
+#endif
+#undef  LCD_WRITE_BYTE
+#define LCD_WRITE_BYTE(lcd,b,rs) (lcd_enqueue((lcd),(b),(rs) ? LCD_QUEUE_RS : 0))
+#endif
+
+#endif /* LCD_H_ */
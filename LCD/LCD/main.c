@@ -5,40 +5,103 @@
  *  Author: Matthijs
  */
 
-#define F_CPU 2000000UL
-
 #include <avr/io.h>
-#include <util/delay.h>
-#include <stdlib.h>
+#include "clock.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include "lcd.h"
-#include "spi.h"
-#define FOO 0
+#include "Spi.h"
+#include "rfid.h"
+#include "sched.h"
+#include "trace.h"
+#define RFID_SPI_HZ 4000000UL						// SPI clock of the RFID reader
+#define RFID_USE_IRQ 1								// 1: card detect interrupt, 0: polling
+#define RFID_IRQ_PORT PORTE							// card detect of the reader, active low
+#define RFID_IRQ_bm PIN1_bm
+#define RFID_IRQ_vect PORTE_INT0_vect
+#define RFID_POLL_MS 20								// poll interval without interrupt
+#define LCD_UPDATE_MS 20							// framebuffer flush interval
+#define BLINK_MS 500								// status LED toggle interval
+
+static volatile uint8_t rfid_event = 0;				// set when a card was detected
+static lcd_t lcd;									// 16x2 display on the E line of lcd.h
+
+/*
+ * The screen: the labels stay in flash and are sent once, a new UID only
+ * rewrites its hex fields.
+ */
+#define FIELD_UID 0									// RFID_UID_LEN fields of one byte
+static const char screen_layout[] PROGMEM = "RFID UID:\n--------";
+static const lcd_field_t screen_fields[RFID_UID_LEN] PROGMEM = {
+	{ 0, 1, 2, 16 }, { 2, 1, 2, 16 }, { 4, 1, 2, 16 }, { 6, 1, 2, 16 },
+};
+static const lcd_template_t screen PROGMEM = { screen_layout, screen_fields, RFID_UID_LEN };
+
+#if RFID_USE_IRQ==1
+void rfid_irq_init(void)
+{
+	RFID_IRQ_PORT.DIRCLR = RFID_IRQ_bm;
+	RFID_IRQ_PORT.PIN1CTRL = PORT_OPC_PULLUP_gc | PORT_ISC_FALLING_gc;
+	RFID_IRQ_PORT.INT0MASK = RFID_IRQ_bm;
+	RFID_IRQ_PORT.INTCTRL = PORT_INT0LVL_LO_gc;
+	PMIC.CTRL |= PMIC_LOLVLEN_bm;
+}
+
+ISR(RFID_IRQ_vect)
+{
+	rfid_event = 1;
+}
+#endif
+
+/*
+ * Reads the tag after a card detect, or every RFID_POLL_MS, and writes
+ * a new UID into the framebuffer.
+ */
+void rfid_task(void)
+{
+	uint8_t uid[RFID_UID_LEN];
+	
+#if RFID_USE_IRQ==1
+	if (!rfid_event)
+		return;									// no card
+	rfid_event = 0;
+#endif
+	if (rfid_read(uid, sched_time()) != RFID_NEW)
+		return;									// CRC error or the same tag again
+	
+	for (uint8_t i = 0; i < RFID_UID_LEN; i++)
+		lcd_field_num(&lcd, FIELD_UID + i, uid[i]);
+}
+
+void lcd_task(void)
+{
+	lcd_fb_flush(&lcd);							// only changed characters
+}
 
-uint8_t spi_read_byte(void)
+void blink_task(void)
 {
-	uint8_t data;
-	PORTC.OUTCLR = SPI_SS_bm;
-	data = spi_transfer(FOO);
-	PORTC.OUTSET = SPI_SS_bm;
-	return data;
+	PORTE.OUTTGL = PIN0_bm;
 }
 
 int main(void){
-	lcd_init();
-	spi_init();
+	clock_init();
+#if TRACE==1
+	trace_init();
+#endif
+	lcd_init(&lcd, &LCD_E_PORT, LCD_E_bp, 2, 16);
+	spi_init(RFID_SPI_HZ);
+	sched_init();
 	PORTE.DIRSET = PIN0_bm;
-	char buffer[3];
-				 
-	while(1)
-	{
-		uint8_t data = spi_read_byte();
-		
-		lcd_puts("RFID data:");
-		lcd_gotoxy(0, 1);
-		
-		utoa( data, buffer, 10 );
-		lcd_puts(buffer);
-		_delay_ms(2000);
-		lcd_clear();
-	}
+#if RFID_USE_IRQ==1
+	rfid_irq_init();
+	sched_add(rfid_task, 1, 5);
+#else
+	sched_add(rfid_task, RFID_POLL_MS, 5);
+#endif
+	sched_add(lcd_task, LCD_UPDATE_MS, LCD_UPDATE_MS);
+	sched_add(blink_task, BLINK_MS, 10);
+	sei();										// lcd write queue runs on interrupts
+	
+	lcd_template(&lcd, &screen);
+	sched_run();
 }
\ No newline at end of file
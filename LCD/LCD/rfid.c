@@ -0,0 +1,95 @@
+/*
+ * rfid.c
+ *
+ * RFID frame reader with CRC check and a set of recently seen tags,
+ * see rfid.h.
+ */
+
+#include <avr/io.h>
+#include <util/crc16.h>
+#include <string.h>
+#include "rfid.h"
+#include "Spi.h"
+
+#define RFID_CRC_INIT	0x6363							// CRC_A preset
+
+typedef struct {
+	uint8_t uid[RFID_UID_LEN];
+	uint32_t time;										// ms of the last read
+	uint8_t used;
+} rfid_entry_t;
+
+static rfid_entry_t rfid_set[RFID_SEEN_SIZE];
+
+/*
+ * Reads one frame, copies the UID to uid and returns RFID_NEW, RFID_REPEAT
+ * or RFID_ERROR. now is the time in ms.
+ */
+uint8_t rfid_read(uint8_t *uid, uint32_t now)
+{
+	uint8_t frame[RFID_FRAME_LEN];
+	uint16_t crc = RFID_CRC_INIT;
+
+	SPI_SS_LOW();
+	spi_transfer_block(NULL, frame, RFID_FRAME_LEN);	// whole frame in one window
+	SPI_SS_HIGH();
+
+	for (uint8_t i = 0; i < RFID_FRAME_LEN; i++)
+		crc = _crc_ccitt_update(crc, frame[i]);
+	if (crc != 0)										// UID and CRC leave no remainder
+		return RFID_ERROR;
+
+	memcpy(uid, frame, RFID_UID_LEN);
+	return rfid_seen(uid, now) ? RFID_REPEAT : RFID_NEW;
+}
+
+static uint8_t rfid_hash(const uint8_t *uid)
+{
+	uint8_t h = 0;
+
+	for (uint8_t i = 0; i < RFID_UID_LEN; i++)
+		h = (uint8_t)((h << 3) | (h >> 5)) ^ uid[i];
+	return h & (RFID_SEEN_SIZE - 1);
+}
+
+/*
+ * Returns 1 when uid was seen less than RFID_SEEN_MS ago, and stores now
+ * as its last read. The set uses open addressing with linear probing.
+ * Expired entries stay in place to keep the probe chains intact and are
+ * reused for new UIDs. The 32 bit times only wrap after 49 days, a tag
+ * read again after a multiple of that is taken for a repeat.
+ */
+uint8_t rfid_seen(const uint8_t *uid, uint32_t now)
+{
+	uint8_t i = rfid_hash(uid);
+	rfid_entry_t *slot = NULL;
+
+	for (uint8_t n = 0; n < RFID_SEEN_SIZE; n++)
+	{
+		rfid_entry_t *e = &rfid_set[i];
+
+		if (!e->used)
+		{
+			if (slot == NULL)
+				slot = e;
+			break;										// end of the chain
+		}
+		if (memcmp(e->uid, uid, RFID_UID_LEN) == 0)
+		{
+			uint8_t recent = now - e->time < RFID_SEEN_MS;
+
+			e->time = now;
+			return recent;
+		}
+		if (slot == NULL && now - e->time >= RFID_SEEN_MS)
+			slot = e;									// expired, can be reused
+		i = (i + 1) & (RFID_SEEN_SIZE - 1);
+	}
+	if (slot == NULL)									// full of recent tags
+		slot = &rfid_set[rfid_hash(uid)];
+
+	memcpy(slot->uid, uid, RFID_UID_LEN);
+	slot->time = now;
+	slot->used = 1;
+	return 0;
+}
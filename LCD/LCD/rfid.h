@@ -0,0 +1,32 @@
+/*
+ * rfid.h
+ *
+ * Reads tag frames from the RFID reader on SPI. A frame is the UID
+ * followed by its CRC_A (ISO 14443-3 A, low byte first), clocked in one
+ * chip select window. Recently seen UIDs are kept in a small hash set
+ * with the time they were last read, so a tag held on the reader is
+ * reported once.
+ */
+
+#ifndef RFID_H_
+#define RFID_H_
+
+#include <stdint.h>
+
+#define RFID_UID_LEN	4								// bytes of a UID
+#define RFID_FRAME_LEN	(RFID_UID_LEN + 2)				// UID and CRC
+#define RFID_SEEN_SIZE	16								// hash set slots, power of 2
+#define RFID_SEEN_MS	1000							// a read within this time is a repeat
+
+#define RFID_ERROR		0								// CRC error
+#define RFID_NEW		1								// tag not seen recently
+#define RFID_REPEAT		2								// same tag again within RFID_SEEN_MS
+
+#if RFID_SEEN_SIZE & (RFID_SEEN_SIZE - 1)
+#error "RFID_SEEN_SIZE must be a power of 2"
+#endif
+
+uint8_t rfid_read(uint8_t *uid, uint32_t now);
+uint8_t rfid_seen(const uint8_t *uid, uint32_t now);
+
+#endif /* RFID_H_ */
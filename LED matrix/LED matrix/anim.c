@@ -0,0 +1,134 @@
+/*
+ * anim.c
+ *
+ * Player for the run length coded animations in flash, see anim.h.
+ */
+
+#include <avr/pgmspace.h>
+#include <stddef.h>
+#include <string.h>
+#include "anim.h"
+#include "matrix.h"
+
+#define ANIM_PLANE		(MATRIX_ROWS * MATRIX_MODULES)		// bytes of one bit plane
+#define ANIM_KEY		0x80								// duration flag: frame stored as it is
+
+/*
+ * Starts animation number from anim_table, the first frame is drawn on an
+ * empty back buffer. Returns 0 when the animation does not fit this
+ * matrix.
+ */
+uint8_t anim_start(anim_t *anim, uint8_t number)
+{
+	const uint8_t *data;
+	uint8_t bits;
+
+	if (number >= ANIM_COUNT)
+		return 0;
+	data = (const uint8_t *)pgm_read_ptr(&anim_table[number]);
+	bits = pgm_read_byte(&data[0]);
+	if ((bits != 1 && bits != MATRIX_BITS) || pgm_read_byte(&data[1]) != MATRIX_MODULES)
+		return 0;
+
+	anim->data = data;
+	anim->next = data + 4;
+	anim->bits = bits;
+	anim->clear = 1;
+	return 1;
+}
+
+/*
+ * XORs v into byte i of the frame. A one bit animation goes into every
+ * plane, so it shows at full intensity.
+ */
+static void anim_xor(anim_t *anim, uint8_t *buffer, uint16_t i, uint8_t v)
+{
+	if (anim->bits == 1)
+	{
+		for (uint8_t b = 0; b < MATRIX_BITS; b++)
+			buffer[b * ANIM_PLANE + i] ^= v;
+	}
+	else
+		buffer[i] ^= v;
+}
+
+/*
+ * Unpacks the next frame into the back buffer and returns how many matrix
+ * frames to show it. Call it only when matrix_ready() returns 1. Returns 0 and stops at the end of an animation that
+ * does not loop.
+ */
+uint8_t anim_frame(anim_t *anim)
+{
+	const uint8_t *p = anim->next;
+	uint8_t *buffer = (uint8_t *)matrix_backbuffer();
+	uint16_t size = anim->bits * ANIM_PLANE;
+	uint8_t duration;
+
+	if (p == NULL)
+		return 0;
+	duration = pgm_read_byte(p++);
+	if (duration == 0)										// end of the animation
+	{
+		uint16_t loop = pgm_read_word(&anim->data[2]);
+
+		if (loop == 0)
+		{
+			anim->next = NULL;
+			return 0;
+		}
+		p = anim->data + loop;
+		duration = pgm_read_byte(p++);
+		anim->clear = 1;									// the first frame starts from empty
+	}
+	if (anim->clear)
+	{
+		memset(buffer, 0, MATRIX_BITS * ANIM_PLANE);
+		anim->clear = 0;
+	}
+
+	if (duration & ANIM_KEY)								// plain frame
+	{
+		if (anim->bits == 1)
+		{
+			for (uint16_t i = 0; i < size; i++)
+			{
+				uint8_t v = pgm_read_byte(p++);
+
+				for (uint8_t b = 0; b < MATRIX_BITS; b++)
+					buffer[b * ANIM_PLANE + i] = v;
+			}
+		}
+		else
+		{
+			memcpy_P(buffer, p, size);
+			p += size;
+		}
+		anim->next = p;
+		return duration & ~ANIM_KEY;
+	}
+
+	for (uint16_t i = 0; i < size; )
+	{
+		uint8_t c = pgm_read_byte(p++);
+		uint8_t n = (c & 0x7F) + 1;
+
+		if (c & 0x80)										// run of one byte
+		{
+			uint8_t v = pgm_read_byte(p++);
+
+			if (v != 0)
+			{
+				for (uint8_t k = 0; k < n; k++)
+					anim_xor(anim, buffer, i + k, v);
+			}
+			i += n;
+		}
+		else												// literal bytes
+		{
+			for (uint8_t k = 0; k < n; k++)
+				anim_xor(anim, buffer, i++, pgm_read_byte(p++));
+		}
+	}
+	anim->next = p;
+	return duration;
+}
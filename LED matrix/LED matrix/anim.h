@@ -0,0 +1,25 @@
+/*
+ * anim.h
+ *
+ * Player for the animations in flash from anim_data.c. Each frame is
+ * unpacked straight into the back buffer of the matrix, see animc.py for
+ * the format.
+ */
+
+#ifndef ANIM_H_
+#define ANIM_H_
+
+#include <stdint.h>
+#include "anim_data.h"
+
+typedef struct {
+	const uint8_t *data;									// animation in flash
+	const uint8_t *next;									// next record, NULL when stopped
+	uint8_t bits;											// bit planes in the animation
+	uint8_t clear;											// clear the back buffer before the next frame
+} anim_t;
+
+uint8_t anim_start(anim_t *anim, uint8_t number);
+uint8_t anim_frame(anim_t *anim);
+
+#endif /* ANIM_H_ */
@@ -0,0 +1,41 @@
+/*
+ * anim_data.c
+ *
+ * Generated by animc.py from anim.txt, do not edit.
+ */
+
+#include "anim_data.h"
+
+// heart: 2 frames, 1 bit, 1 module(s), 23 bytes (23 as plain frames)
+static const uint8_t anim_heart[] PROGMEM = {
+	0x01, 0x01, 0x04, 0x00, 0xA8, 0x00, 0x18, 0x3C, 0x7E, 0xFF, 0xFF, 0x66,
+	0x00, 0x8F, 0x00, 0x00, 0x00, 0x18, 0x3C, 0x24, 0x00, 0x00, 0x00,
+};
+
+// fade: 4 frames, 4 bit, 1 module(s), 122 bytes (137 as plain frames)
+static const uint8_t anim_fade[] PROGMEM = {
+	0x04, 0x01, 0x04, 0x00, 0x88, 0xAA, 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA,
+	0x55, 0xCC, 0xE6, 0x73, 0x39, 0x9C, 0xCE, 0x67, 0x33, 0xF0, 0xF8, 0xFC,
+	0xFE, 0x7F, 0x3F, 0x1F, 0x0F, 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02,
+	0x01, 0x08, 0x87, 0xFF, 0x17, 0x55, 0x2A, 0x95, 0x4A, 0xA5, 0x52, 0xA9,
+	0x54, 0x11, 0x08, 0x04, 0x02, 0x81, 0x40, 0x20, 0x10, 0x81, 0xC0, 0x60,
+	0x30, 0x18, 0x0C, 0x06, 0x03, 0x08, 0x87, 0xFF, 0x17, 0xAA, 0x55, 0x2A,
+	0x95, 0x4A, 0xA5, 0x52, 0xA9, 0x22, 0x11, 0x08, 0x04, 0x02, 0x81, 0x40,
+	0x20, 0x03, 0x81, 0xC0, 0x60, 0x30, 0x18, 0x0C, 0x06, 0x08, 0x87, 0xFF,
+	0x17, 0x55, 0xAA, 0x55, 0x2A, 0x95, 0x4A, 0xA5, 0x52, 0x44, 0x22, 0x11,
+	0x08, 0x04, 0x02, 0x81, 0x40, 0x06, 0x03, 0x81, 0xC0, 0x60, 0x30, 0x18,
+	0x0C, 0x00,
+};
+
+// wipe: 8 frames, 1 bit, 1 module(s), 29 bytes (77 as plain frames)
+static const uint8_t anim_wipe[] PROGMEM = {
+	0x01, 0x01, 0x00, 0x00, 0x06, 0x87, 0x80, 0x06, 0x87, 0x40, 0x06, 0x87,
+	0x20, 0x06, 0x87, 0x10, 0x06, 0x87, 0x08, 0x06, 0x87, 0x04, 0x06, 0x87,
+	0x02, 0x1E, 0x87, 0x01, 0x00,
+};
+
+const uint8_t * const anim_table[ANIM_COUNT] PROGMEM = {
+	anim_heart,
+	anim_fade,
+	anim_wipe,
+};
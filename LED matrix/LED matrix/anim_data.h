@@ -0,0 +1,21 @@
+/*
+ * anim_data.h
+ *
+ * Generated by animc.py from anim.txt, do not edit.
+ */
+
+#ifndef ANIM_DATA_H_
+#define ANIM_DATA_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#define ANIM_COUNT	3
+
+#define ANIM_HEART	0
+#define ANIM_FADE	1
+#define ANIM_WIPE	2
+
+extern const uint8_t * const anim_table[ANIM_COUNT] PROGMEM;
+
+#endif /* ANIM_DATA_H_ */
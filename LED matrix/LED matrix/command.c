@@ -0,0 +1,144 @@
+/*
+ * command.c
+ *
+ * Frames from the host that change the scrolling text, see command.h.
+ */
+
+#include <string.h>
+#include "command.h"
+#include "matrix.h"
+#include "uart.h"
+
+#define COMMAND_IDLE		0						// waiting for STX
+#define COMMAND_CMD			1
+#define COMMAND_LEN			2
+#define COMMAND_DATA		3
+#define COMMAND_CHECK		4
+
+static char command_message[2][COMMAND_MESSAGE_MAX];	// shown and spare message
+static uint8_t command_data[COMMAND_MESSAGE_MAX];
+static uint8_t command_state = COMMAND_IDLE;
+static uint8_t command_cmd, command_len, command_count, command_sum;
+static uint8_t command_last;						// matrix frame of the last byte
+
+void command_init(text_t *text, const char *message)
+{
+	strncpy(command_message[0], message, COMMAND_MESSAGE_MAX - 1);
+	command_message[0][COMMAND_MESSAGE_MAX - 1] = 0;
+	text_start(text, command_message[0]);
+}
+
+/*
+ * Buffer that is not being shown, it holds the pending message if any.
+ */
+static char *command_spare(text_t *text)
+{
+	return text->message == command_message[0] ? command_message[1] : command_message[0];
+}
+
+/*
+ * Applies the received frame, returns 0 when it is not valid.
+ */
+static uint8_t command_apply(text_t *text, anim_t *anim, uint8_t *speed)
+{
+	char *spare = command_spare(text);
+	const char *latest;
+	uint8_t n;
+
+	switch (command_cmd)
+	{
+	case 'M':
+		if (command_len >= COMMAND_MESSAGE_MAX)
+			return 0;
+		memcpy(spare, command_data, command_len);
+		spare[command_len] = 0;
+		text_replace(text, spare);
+		return 1;
+	case 'A':
+		latest = text->pending != NULL ? text->pending : text->message;
+		n = strlen(latest);
+		if (n + command_len >= COMMAND_MESSAGE_MAX)
+			return 0;
+		if (latest != spare)
+			memcpy(spare, latest, n);
+		memcpy(spare + n, command_data, command_len);
+		spare[n + command_len] = 0;
+		text_append(text, spare);
+		return 1;
+	case 'F':
+		if (command_len != 1 || command_data[0] > 1)
+			return 0;
+		text->fixed = command_data[0];
+		return 1;
+	case 'S':
+		if (command_len != 1 || command_data[0] == 0)
+			return 0;
+		*speed = command_data[0];
+		return 1;
+	case 'B':
+		if (command_len != 1)
+			return 0;
+		matrix_brightness(command_data[0]);
+		return 1;
+	case 'P':
+		if (command_len != 1)
+			return 0;
+		if (command_data[0] == 255)
+		{
+			anim->next = NULL;
+			return 1;
+		}
+		return anim_start(anim, command_data[0]);
+	}
+	return 0;
+}
+
+/*
+ * Handles the bytes received since the last call. Call it often enough
+ * that the receive buffer of the USART does not fill up.
+ */
+void command_poll(text_t *text, anim_t *anim, uint8_t *speed)
+{
+	int16_t c;
+
+	if (command_state != COMMAND_IDLE && (uint8_t)(matrix_frames() - command_last) > COMMAND_TIMEOUT)
+		command_state = COMMAND_IDLE;				// drop a stalled frame
+
+	while ((c = uart_getc()) >= 0)
+	{
+		command_last = matrix_frames();
+		switch (command_state)
+		{
+		case COMMAND_IDLE:
+			if (c == COMMAND_STX)
+			{
+				command_sum = 0;
+				command_state = COMMAND_CMD;
+			}
+			break;
+		case COMMAND_CMD:
+			command_cmd = c;
+			command_sum += c;
+			command_state = COMMAND_LEN;
+			break;
+		case COMMAND_LEN:
+			command_len = c;
+			command_sum += c;
+			command_count = 0;
+			command_state = command_len != 0 ? COMMAND_DATA : COMMAND_CHECK;
+			break;
+		case COMMAND_DATA:
+			if (command_count < COMMAND_MESSAGE_MAX)
+				command_data[command_count] = c;
+			command_sum += c;
+			if (++command_count == command_len)
+				command_state = COMMAND_CHECK;
+			break;
+		case COMMAND_CHECK:
+			command_sum += c;
+			command_state = COMMAND_IDLE;
+			uart_putc(command_sum == 0 && command_apply(text, anim, speed) ? COMMAND_ACK : COMMAND_NAK);
+			break;
+		}
+	}
+}
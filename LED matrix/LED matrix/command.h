@@ -0,0 +1,39 @@
+/*
+ * command.h
+ *
+ * Frames from the host on the USART that change the scrolling text.
+ *
+ * A frame is STX, command, length, length data bytes and a check byte.
+ * The check byte makes the sum of command, length, data and check 0
+ * modulo 256. The display answers ACK when the frame is applied and NAK
+ * when it is not. A frame that stalls for COMMAND_TIMEOUT frames of the
+ * matrix is dropped.
+ *
+ *   'M' text		replace the message
+ *   'A' text		append to the message
+ *   'F' n			font, 0 proportional, 1 fixed width
+ *   'S' n			speed, matrix frames per column (1 to 255)
+ *   'B' n			brightness, 255 is full
+ *   'P' n			play animation n from anim_data.h, 255 goes back to the text
+ *
+ * A new message takes over at the next character boundary. An appended
+ * one goes on from the character the old one was at.
+ */
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdint.h>
+#include "text.h"
+#include "anim.h"
+
+#define COMMAND_STX			0x02
+#define COMMAND_ACK			0x06
+#define COMMAND_NAK			0x15
+#define COMMAND_MESSAGE_MAX	128						// bytes of a message including the 0
+#define COMMAND_TIMEOUT		5						// frames of the matrix
+
+void command_init(text_t *text, const char *message);
+void command_poll(text_t *text, anim_t *anim, uint8_t *speed);
+
+#endif /* COMMAND_H_ */
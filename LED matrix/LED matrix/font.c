@@ -0,0 +1,120 @@
+/*
+ * font.c
+ *
+ * Generated by fontc.py from font.txt, do not edit.
+ */
+
+#include "font.h"
+
+const uint8_t font_columns[] PROGMEM = {
+	0x00, 0x00, 0x00,             	// ' '
+	0xFD,                         	// '!'
+	0xE0, 0x00, 0xE0,             	// '"'
+	0x24, 0x7E, 0x24, 0x7E, 0x24, 	// '#'
+	0x22, 0x52, 0xFF, 0x52, 0x4C, 	// '$'
+	0xC2, 0xC4, 0x18, 0x23, 0x43, 	// '%'
+	0x6E, 0x91, 0xA9, 0x46, 0x09, 	// '&'
+	0xE0,                         	// '''
+	0x3C, 0x42, 0x81,             	// '('
+	0x81, 0x42, 0x3C,             	// ')'
+	0x28, 0x10, 0x7C, 0x10, 0x28, 	// '*'
+	0x08, 0x08, 0x3E, 0x08, 0x08, 	// '+'
+	0x05, 0x06,                   	// ','
+	0x08, 0x08, 0x08, 0x08, 0x08, 	// '-'
+	0x03, 0x03,                   	// '.'
+	0x01, 0x06, 0x08, 0x30, 0x40, 	// '/'
+	0x7E, 0x85, 0x99, 0xA1, 0x7E, 	// '0'
+	0x21, 0x41, 0xFF, 0x01, 0x01, 	// '1'
+	0x43, 0x85, 0x89, 0x91, 0x61, 	// '2'
+	0x42, 0x81, 0x91, 0x91, 0x6E, 	// '3'
+	0x18, 0x28, 0x48, 0xFF, 0x08, 	// '4'
+	0xF2, 0x91, 0x91, 0x91, 0x8E, 	// '5'
+	0x3E, 0x51, 0x91, 0x91, 0x0E, 	// '6'
+	0x80, 0x83, 0x8C, 0xB0, 0xC0, 	// '7'
+	0x6E, 0x91, 0x91, 0x91, 0x6E, 	// '8'
+	0x70, 0x89, 0x89, 0x8A, 0x7C, 	// '9'
+	0x66, 0x66,                   	// ':'
+	0x65, 0x66,                   	// ';'
+	0x08, 0x14, 0x22, 0x41,       	// '<'
+	0x24, 0x24, 0x24, 0x24, 0x24, 	// '='
+	0x41, 0x22, 0x14, 0x08,       	// '>'
+	0x40, 0x80, 0x8D, 0x90, 0x60, 	// '?'
+	0x7E, 0x81, 0xB9, 0xA9, 0x7A, 	// '@'
+	0x7F, 0x88, 0x88, 0x88, 0x7F, 	// 'A'
+	0xFF, 0x91, 0x91, 0x91, 0x6E, 	// 'B'
+	0x7E, 0x81, 0x81, 0x81, 0x42, 	// 'C'
+	0xFF, 0x81, 0x81, 0x81, 0x7E, 	// 'D'
+	0xFF, 0x91, 0x91, 0x91, 0x81, 	// 'E'
+	0xFF, 0x90, 0x90, 0x90, 0x80, 	// 'F'
+	0x7E, 0x81, 0x89, 0x89, 0x0E, 	// 'G'
+	0xFF, 0x10, 0x10, 0x10, 0xFF, 	// 'H'
+	0x81, 0xFF, 0x81,             	// 'I'
+	0x02, 0x81, 0xFE, 0x80,       	// 'J'
+	0xFF, 0x10, 0x28, 0x44, 0x83, 	// 'K'
+	0xFF, 0x01, 0x01, 0x01, 0x01, 	// 'L'
+	0xFF, 0x80, 0x70, 0x80, 0xFF, 	// 'M'
+	0xFF, 0x40, 0x20, 0x10, 0xFF, 	// 'N'
+	0x7E, 0x81, 0x81, 0x81, 0x7E, 	// 'O'
+	0xFF, 0x90, 0x90, 0x90, 0x60, 	// 'P'
+	0x7E, 0x81, 0x85, 0x83, 0x7F, 	// 'Q'
+	0x7F, 0x88, 0x8C, 0x8A, 0x71, 	// 'R'
+	0x61, 0x91, 0x91, 0x91, 0x8E, 	// 'S'
+	0x80, 0x80, 0xFF, 0x80, 0x80, 	// 'T'
+	0xFE, 0x01, 0x01, 0x01, 0xFE, 	// 'U'
+	0xFC, 0x02, 0x01, 0x02, 0xFC, 	// 'V'
+	0xFE, 0x01, 0x0F, 0x01, 0xFE, 	// 'W'
+	0x81, 0x66, 0x18, 0x66, 0x81, 	// 'X'
+	0x80, 0x60, 0x1F, 0x60, 0x80, 	// 'Y'
+	0x83, 0x85, 0x89, 0xB1, 0xC1, 	// 'Z'
+	0xFF, 0x81, 0x81,             	// '['
+	0x40, 0x30, 0x08, 0x06, 0x01, 	// '\'
+	0x81, 0x81, 0xFF,             	// ']'
+	0x20, 0x40, 0x80, 0x40, 0x20, 	// '^'
+	0x01, 0x01, 0x01, 0x01, 0x01, 	// '_'
+	0x80, 0x40,                   	// '`'
+	0x02, 0x15, 0x15, 0x15, 0x0F, 	// 'a'
+	0xFF, 0x11, 0x11, 0x11, 0x0E, 	// 'b'
+	0x0E, 0x11, 0x11, 0x11, 0x02, 	// 'c'
+	0x0E, 0x11, 0x11, 0x11, 0xFF, 	// 'd'
+	0x0E, 0x15, 0x15, 0x15, 0x0C, 	// 'e'
+	0x10, 0x7F, 0x90, 0x90, 0x40, 	// 'f'
+	0x32, 0x49, 0x49, 0x49, 0x7E, 	// 'g'
+	0xFF, 0x08, 0x10, 0x10, 0x0F, 	// 'h'
+	0x11, 0x5F, 0x01,             	// 'i'
+	0x02, 0x01, 0x21, 0xBE,       	// 'j'
+	0xFF, 0x08, 0x14, 0x22, 0x01, 	// 'k'
+	0x81, 0xFF, 0x01,             	// 'l'
+	0x1F, 0x10, 0x0E, 0x10, 0x0F, 	// 'm'
+	0x1F, 0x08, 0x10, 0x10, 0x0F, 	// 'n'
+	0x0E, 0x11, 0x11, 0x11, 0x0E, 	// 'o'
+	0x7F, 0x48, 0x48, 0x48, 0x30, 	// 'p'
+	0x30, 0x48, 0x48, 0x48, 0x7F, 	// 'q'
+	0x1F, 0x08, 0x10, 0x10, 0x08, 	// 'r'
+	0x09, 0x15, 0x15, 0x15, 0x12, 	// 's'
+	0x10, 0x7E, 0x11, 0x11, 0x02, 	// 't'
+	0x1E, 0x01, 0x01, 0x02, 0x1F, 	// 'u'
+	0x1C, 0x02, 0x01, 0x02, 0x1C, 	// 'v'
+	0x1E, 0x01, 0x06, 0x01, 0x1E, 	// 'w'
+	0x11, 0x0A, 0x04, 0x0A, 0x11, 	// 'x'
+	0x72, 0x09, 0x09, 0x09, 0x7E, 	// 'y'
+	0x11, 0x13, 0x15, 0x19, 0x11, 	// 'z'
+	0x10, 0x6E, 0x81, 0x81,       	// '{'
+	0xFF,                         	// '|'
+	0x81, 0x81, 0x6E, 0x10,       	// '}'
+	0x08, 0x10, 0x08, 0x04, 0x08, 	// '~'
+};
+
+const uint16_t font_offset[FONT_LAST - FONT_FIRST + 2] PROGMEM = {
+	0, 3, 4, 7, 12, 17, 22, 27,
+	28, 31, 34, 39, 44, 46, 51, 53,
+	58, 63, 68, 73, 78, 83, 88, 93,
+	98, 103, 108, 110, 112, 116, 121, 125,
+	130, 135, 140, 145, 150, 155, 160, 165,
+	170, 175, 178, 182, 187, 192, 197, 202,
+	207, 212, 217, 222, 227, 232, 237, 242,
+	247, 252, 257, 262, 265, 270, 273, 278,
+	283, 285, 290, 295, 300, 305, 310, 315,
+	320, 325, 328, 332, 337, 340, 345, 350,
+	355, 360, 365, 370, 375, 380, 385, 390,
+	395, 400, 405, 410, 414, 415, 419, 424,
+};
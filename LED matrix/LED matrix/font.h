@@ -0,0 +1,50 @@
+/*
+ * font.h
+ *
+ * Generated by fontc.py from font.txt, do not edit.
+ */
+
+#ifndef FONT_H_
+#define FONT_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#define FONT_FIRST		0x20						// first character in the table
+#define FONT_LAST		0x7E						// last character in the table
+#define FONT_MAX_WIDTH	5							// columns of the widest glyph
+#define FONT_HEIGHT		8							// rows per glyph
+
+extern const uint8_t font_columns[] PROGMEM;
+extern const uint16_t font_offset[FONT_LAST - FONT_FIRST + 2] PROGMEM;
+
+/*
+ * Index of c in font_offset. Characters outside the table show as '?'.
+ */
+static inline uint8_t font_index(char c)
+{
+	if ((uint8_t)c < FONT_FIRST || (uint8_t)c > FONT_LAST)
+		c = '?';
+	return (uint8_t)c - FONT_FIRST;
+}
+
+/*
+ * Returns the glyph of c in flash, one byte per column with the left
+ * column first and bit 0 as the bottom row.
+ */
+static inline const uint8_t *font_glyph(char c)
+{
+	return font_columns + pgm_read_word(&font_offset[font_index(c)]);
+}
+
+/*
+ * Returns the number of columns of the glyph of c.
+ */
+static inline uint8_t font_width(char c)
+{
+	uint8_t i = font_index(c);
+
+	return pgm_read_word(&font_offset[i + 1]) - pgm_read_word(&font_offset[i]);
+}
+
+#endif /* FONT_H_ */
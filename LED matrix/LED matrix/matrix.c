@@ -0,0 +1,210 @@
+/*
+ * matrix.c
+ *
+ * Refresh of the LED matrix modules by a timer interrupt, see matrix.h.
+ * Each module gets two bytes per row: the row select and the row data.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <string.h>
+#include "matrix.h"
+#include "Spi.h"
+#include "trace.h"
+
+static matrix_plane_t matrix_buffer[2][MATRIX_BITS];
+static volatile uint8_t matrix_front = 0;			// buffer that is displayed
+static volatile uint8_t matrix_swap_request = 0;	// swap after the last row
+static uint8_t matrix_copy = 0;						// back buffer still needs the new image
+static uint8_t matrix_row = 0;						// next row to display
+static uint8_t matrix_plane = 0;					// next bit plane to display
+static volatile uint8_t matrix_frame = 0;			// frames shown, wraps around
+static uint16_t matrix_blank[MATRIX_BITS];			// blanking compare per plane
+static uint8_t matrix_line[2 * MATRIX_MODULES];		// row being sent
+static const uint8_t matrix_off[2 * MATRIX_MODULES] = { 0 };	// no row selected
+static spi_xfer_t matrix_row_xfer = { matrix_line, NULL, sizeof(matrix_line), &PORTC, MATRIX_LATCH_bm, 1, NULL };
+static spi_xfer_t matrix_off_xfer = { matrix_off, NULL, sizeof(matrix_off), &PORTC, MATRIX_LATCH_bm, 1, NULL };
+
+void matrix_init(void)
+{
+	PORTC.OUTSET = MATRIX_LATCH_bm;
+	PORTC.DIRSET = MATRIX_LATCH_bm;
+	memset(matrix_buffer, 0, sizeof(matrix_buffer));
+	matrix_brightness(255);
+
+	MATRIX_TC.PER = MATRIX_SLOT - 1;
+	MATRIX_TC.PERBUF = MATRIX_SLOT - 1;				// length of the first plane
+	MATRIX_TC.CCABUF = matrix_blank[0];
+	MATRIX_TC.INTCTRLA = TC_OVFINTLVL_MED_gc;
+	MATRIX_TC.INTCTRLB = TC_CCAINTLVL_MED_gc;
+	MATRIX_TC.CTRLA = MATRIX_TC_CLKSEL;
+	PMIC.CTRL |= PMIC_MEDLVLEN_bm;
+}
+
+/*
+ * Returns the buffer to draw in, MATRIX_BITS planes with the least
+ * significant plane first. Byte [y][m] of a plane is row y of module m,
+ * bit 0 is the right most column of the module.
+ */
+matrix_plane_t *matrix_backbuffer(void)
+{
+	return matrix_buffer[matrix_front ^ 1];
+}
+
+/*
+ * Shows the back buffer from the next frame on and returns at once. Do
+ * not draw until matrix_ready() returns 1.
+ */
+void matrix_swap(void)
+{
+	matrix_copy = 1;
+	matrix_swap_request = 1;
+}
+
+/*
+ * Returns 1 when the back buffer may be drawn in. After a swap this is at
+ * the end of the frame, when the new front buffer is copied to the back
+ * buffer, so the application can keep drawing on the last image.
+ */
+uint8_t matrix_ready(void)
+{
+	if (matrix_swap_request)
+		return 0;
+	if (matrix_copy)
+	{
+		memcpy(matrix_buffer[matrix_front ^ 1], matrix_buffer[matrix_front], sizeof(matrix_buffer[0]));
+		matrix_copy = 0;
+	}
+	return 1;
+}
+
+/*
+ * Returns the number of frames shown, modulo 256.
+ */
+uint8_t matrix_frames(void)
+{
+	return matrix_frame;
+}
+
+/*
+ * Sets the pixel in column x (0 is left) of row y (0 is bottom) in the
+ * back buffer to level, 0 to MATRIX_LEVELS - 1.
+ */
+void matrix_set(uint8_t x, uint8_t y, uint8_t level)
+{
+	matrix_plane_t *planes = matrix_backbuffer();
+	uint8_t m = x >> 3;
+	uint8_t mask = 0x80 >> (x & 7);
+
+	for (uint8_t b = 0; b < MATRIX_BITS; b++)
+	{
+		if (level & (1 << b))
+			planes[b][y][m] |= mask;
+		else
+			planes[b][y][m] &= ~mask;
+	}
+}
+
+/*
+ * Shifts the back buffer one column to the left over all modules and
+ * puts col in the right most column at full intensity, bit 0 of col is
+ * the bottom row.
+ */
+void matrix_scroll(uint8_t col)
+{
+	matrix_plane_t *planes = matrix_backbuffer();
+
+	for (uint8_t y = 0; y < MATRIX_ROWS; y++)
+	{
+		uint8_t in = col & 1;
+
+		for (uint8_t b = 0; b < MATRIX_BITS; b++)
+		{
+			uint8_t *row = planes[b][y];
+
+			for (uint8_t m = 1; m < MATRIX_MODULES; m++)
+				row[m - 1] = (row[m - 1] << 1) | (row[m] >> 7);
+			row[MATRIX_MODULES - 1] = (row[MATRIX_MODULES - 1] << 1) | in;
+		}
+		col >>= 1;
+	}
+}
+
+/*
+ * Sets the global brightness, 255 is full. Each slot is blanked after
+ * level / 256 of its time, the bit planes keep their ratio.
+ */
+void matrix_brightness(uint8_t level)
+{
+	uint16_t blank[MATRIX_BITS];
+
+	for (uint8_t b = 0; b < MATRIX_BITS; b++)
+	{
+		if (level == 255)
+			blank[b] = 0xFFFF;						// past PER, never matches
+		else
+			blank[b] = ((uint32_t)MATRIX_SLOT * level << b) >> 8;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memcpy(matrix_blank, blank, sizeof(matrix_blank));
+	}
+}
+
+/*
+ * Queues one row for all modules in one burst, the last module first, and
+ * returns while it is sent. The latch is the chip select of the transfer:
+ * low while the bytes go out, its rising edge at the end latches the shift
+ * registers. A push that is still busy is not queued again, MATRIX_SLOT
+ * leaves time for both pushes of a slot.
+ */
+static void matrix_show(uint8_t select, const uint8_t *data)
+{
+	uint8_t *p = matrix_line;
+
+	if (!matrix_row_xfer.done)
+		return;
+	for (uint8_t m = MATRIX_MODULES; m-- > 0; )
+	{
+		*p++ = select;
+		*p++ = data[m];
+	}
+	spi_submit(&matrix_row_xfer);
+}
+
+/*
+ * Start of a slot. PER and CCA were loaded from their buffers at this
+ * overflow, the buffers are set for the slot after this one.
+ */
+ISR(MATRIX_TC_OVF_vect)
+{
+	TRACE_BEGIN(TRACE_MATRIX_ROW);
+	matrix_show(0x80 >> matrix_row, matrix_buffer[matrix_front][matrix_plane][matrix_row]);
+
+	if (++matrix_plane == MATRIX_BITS) {
+		matrix_plane = 0;
+		if (++matrix_row == MATRIX_ROWS) {
+			matrix_row = 0;
+			matrix_frame++;
+			if (matrix_swap_request) {				// vertical sync
+				matrix_front ^= 1;
+				matrix_swap_request = 0;
+			}
+		}
+	}
+	MATRIX_TC.PERBUF = ((uint16_t)MATRIX_SLOT << matrix_plane) - 1;
+	MATRIX_TC.CCABUF = matrix_blank[matrix_plane];
+	TRACE_END(TRACE_MATRIX_ROW);
+}
+
+/*
+ * Brightness: turns the row off for the rest of the slot.
+ */
+ISR(MATRIX_TC_CCA_vect)
+{
+	TRACE_BEGIN(TRACE_MATRIX_BLANK);
+	if (matrix_off_xfer.done)
+		spi_submit(&matrix_off_xfer);
+	TRACE_END(TRACE_MATRIX_BLANK);
+}
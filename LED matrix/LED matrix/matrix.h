@@ -0,0 +1,79 @@
+/*
+ * matrix.h
+ *
+ * Refresh of a chain of 8x8 LED matrix modules by a timer interrupt,
+ * with binary code modulation (BCM) for grey levels.
+ * The MATRIX_MODULES modules form one canvas of MATRIX_WIDTH columns.
+ * Module 0 is the left most and the first on the SPI chain, so its bytes
+ * are sent last. A row of all modules is one SPI burst and one latch.
+ * Every pixel has MATRIX_BITS bits of intensity, stored as bit planes.
+ * The interrupt shows each row once per bit plane. Plane b stays on for
+ * 2^b time slots, so one row costs MATRIX_BITS SPI pushes per frame. The
+ * timer period is reloaded through PERBUF, so the plane times are exact.
+ * The global brightness blanks the row at a compare match part way
+ * through every slot.
+ *
+ * The application draws in the back buffer and calls matrix_swap(), which
+ * exchanges the buffers after the last row of a frame. matrix_ready()
+ * tells when the back buffer may be drawn in again.
+ *
+ * A slot lasts F_CPU / (MATRIX_FRAME_HZ * MATRIX_ROWS * (2^MATRIX_BITS - 1))
+ * clocks. Each push takes MATRIX_PUSH_ISR clocks (3.7 us) in the ISR,
+ * which only queues the row on the SPI. DMA sends it, 1 us per module (two
+ * bytes at 16 MHz SPI), and latches it at the end. With brightness below
+ * 255 there is a second push per slot, so a slot must be at least two
+ * pushes long. For one module this limits the frame rate to about 1 kHz
+ * at 4 bits and about 60 Hz at 8 bits.
+ */
+
+#ifndef MATRIX_H_
+#define MATRIX_H_
+
+#include <stdint.h>
+#include "clock.h"
+
+#define MATRIX_ROWS			8						// rows of the matrix
+#define MATRIX_MODULES		1						// modules on the chain
+#define MATRIX_WIDTH		(8 * MATRIX_MODULES)	// columns of the canvas
+#define MATRIX_BITS			4						// bits of intensity per pixel, 1 is on/off
+#define MATRIX_FRAME_HZ		100						// complete frames per second
+#define MATRIX_LATCH_bm		PIN0_bm					// latch of the shift registers (PORTC)
+
+#define MATRIX_TC			TCC0					// timer for the row scan
+#define MATRIX_TC_OVF_vect	TCC0_OVF_vect
+#define MATRIX_TC_CCA_vect	TCC0_CCA_vect
+#define MATRIX_TC_CLKSEL	TC_CLKSEL_DIV1_gc
+#define MATRIX_TC_DIV		1
+
+#define MATRIX_LEVELS		(1 << MATRIX_BITS)		// grey levels per pixel
+#define MATRIX_SLOT			(F_CPU / MATRIX_TC_DIV / MATRIX_FRAME_HZ / MATRIX_ROWS / (MATRIX_LEVELS - 1))
+#define MATRIX_PUSH_ISR		117						// clocks of the refresh ISR per push, see below
+#define MATRIX_PUSH			(MATRIX_PUSH_ISR + 32 * MATRIX_MODULES)	// clocks of one row push
+
+/*
+ * MATRIX_PUSH_ISR is "cycles per push" of host/matrix_test-dma and
+ * matrix_refresh_per_push of bench/results.txt with SPI_USE_DMA 1: the
+ * register accesses and interrupt entries of the simulator, which counts
+ * no other code. matrix_test fails when it measures more. The SPI adds
+ * two bytes of 16 clocks per module after the ISR.
+ */
+
+#if MATRIX_SLOT * MATRIX_TC_DIV < 2 * MATRIX_PUSH
+#error "MATRIX_SLOT too short, lower MATRIX_FRAME_HZ or MATRIX_BITS"
+#endif
+#if (MATRIX_SLOT << (MATRIX_BITS - 1)) > 0xFFFF
+#error "MATRIX_SLOT too long, raise MATRIX_TC_DIV"
+#endif
+
+typedef uint8_t matrix_plane_t[MATRIX_ROWS][MATRIX_MODULES];	// one bit plane, row 0 is the bottom row
+
+void matrix_init(void);
+matrix_plane_t *matrix_backbuffer(void);
+void matrix_swap(void);
+uint8_t matrix_ready(void);
+uint8_t matrix_frames(void);
+void matrix_set(uint8_t x, uint8_t y, uint8_t level);
+void matrix_scroll(uint8_t col);
+void matrix_brightness(uint8_t level);
+
+#endif /* MATRIX_H_ */
@@ -0,0 +1,95 @@
+/*
+ * text.c
+ *
+ * Column stream of a text in the proportional font, see text.h.
+ */
+
+#include <avr/pgmspace.h>
+#include <stddef.h>
+#include "text.h"
+#include "font.h"
+
+void text_start(text_t *text, const char *message)
+{
+	text->message = message;
+	text->next = message;
+	text->pending = NULL;
+	text->keep = 0;
+	text->lead = 0;
+	text->width = 0;
+	text->gap = 0;
+	text->fixed = 0;
+}
+
+/*
+ * Shows message after the character that is being shown now. The
+ * message must stay unchanged until it is replaced again.
+ */
+void text_replace(text_t *text, const char *message)
+{
+	text->pending = message;
+	text->keep = 0;
+}
+
+/*
+ * Like text_replace(), for a message that starts with the text being
+ * shown, or with the pending one. The scroll goes on at the same
+ * character instead of the first one.
+ */
+void text_append(text_t *text, const char *message)
+{
+	if (text->pending == NULL)
+		text->keep = 1;										// else as the pending text says
+	text->pending = message;
+}
+
+/*
+ * Returns the next column of the text. Each call does a constant amount
+ * of work, whatever the length of the text.
+ */
+uint8_t text_column(text_t *text)
+{
+	if (text->lead != 0)
+	{
+		text->lead--;
+		return 0;
+	}
+	if (text->width == 0)
+	{
+		if (text->gap != 0)
+		{
+			text->gap--;
+			return 0;
+		}
+		if (text->pending != NULL)							// character boundary
+		{
+			text->next = text->pending + (text->keep ? text->next - text->message : 0);
+			text->message = text->pending;
+			text->pending = NULL;
+		}
+		if (*text->next == 0)
+		{
+			text->next = text->message;					// start over
+			if (*text->next == 0)
+				return 0;
+		}
+		text->glyph = font_glyph(*text->next);
+		text->width = font_width(*text->next);
+		text->gap = TEXT_SPACING;
+		if (text->fixed)
+		{
+			uint8_t pad = FONT_MAX_WIDTH - text->width;
+
+			text->lead = pad / 2;
+			text->gap += pad - text->lead;
+		}
+		text->next++;
+		if (text->lead != 0)
+		{
+			text->lead--;
+			return 0;
+		}
+	}
+	text->width--;
+	return pgm_read_byte(text->glyph++);
+}
@@ -0,0 +1,37 @@
+/*
+ * text.h
+ *
+ * Turns a text into a stream of matrix columns, one byte per column with
+ * bit 0 as the bottom row. Glyphs come from the proportional font in
+ * font.c, separated by TEXT_SPACING empty columns. With fixed set every
+ * glyph is centred in FONT_MAX_WIDTH columns. The text starts over after
+ * the last character. A new text from text_replace() takes over at the
+ * next character boundary, from its first character. One from
+ * text_append() continues at the character the old text was at.
+ */
+
+#ifndef TEXT_H_
+#define TEXT_H_
+
+#include <stdint.h>
+
+#define TEXT_SPACING	1									// empty columns after each glyph
+
+typedef struct {
+	const char *message;									// text to show
+	const char *next;										// next character of the text
+	const char *pending;									// text to show from the next character on
+	uint8_t keep;											// 1 when pending continues the message
+	const uint8_t *glyph;									// next column of the glyph in flash
+	uint8_t lead;											// empty columns left before the glyph
+	uint8_t width;											// columns left of the glyph
+	uint8_t gap;											// empty columns left after the glyph
+	uint8_t fixed;											// 1 for fixed width glyphs
+} text_t;
+
+void text_start(text_t *text, const char *message);
+void text_replace(text_t *text, const char *message);
+void text_append(text_t *text, const char *message);
+uint8_t text_column(text_t *text);
+
+#endif /* TEXT_H_ */
@@ -0,0 +1,57 @@
+/*
+ * uart.c
+ *
+ * Interrupt driven USART receive with a ring buffer, see uart.h.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "uart.h"
+
+static uint8_t uart_rx[UART_RX_SIZE];
+static volatile uint8_t uart_head = 0;				// written by the interrupt
+static volatile uint8_t uart_tail = 0;				// read by uart_getc
+
+void uart_init(void)
+{
+	UART_PORT.DIRSET = UART_TX_bm;
+	UART_PORT.OUTSET = UART_TX_bm;					// idle high
+
+	UART.BAUDCTRLA = UART_BSEL & 0xFF;
+	UART.BAUDCTRLB = (UART_BSCALE & 0x0F) << USART_BSCALE_gp | UART_BSEL >> 8;
+	UART.CTRLC = USART_CHSIZE_8BIT_gc;
+	UART.CTRLA = USART_RXCINTLVL_LO_gc;
+	UART.CTRLB = USART_RXEN_bm | USART_TXEN_bm | USART_CLK2X_bm;
+	PMIC.CTRL |= PMIC_LOLVLEN_bm;
+}
+
+/*
+ * Returns the next received byte, or -1 when none is waiting.
+ */
+int16_t uart_getc(void)
+{
+	uint8_t c;
+
+	if (uart_tail == uart_head)
+		return -1;
+	c = uart_rx[uart_tail];
+	uart_tail = (uart_tail + 1) & (UART_RX_SIZE - 1);
+	return c;
+}
+
+void uart_putc(uint8_t c)
+{
+	while (!(UART.STATUS & USART_DREIF_bm));
+	UART.DATA = c;
+}
+
+ISR(UART_RXC_vect)
+{
+	uint8_t c = UART.DATA;
+	uint8_t next = (uart_head + 1) & (UART_RX_SIZE - 1);
+
+	if (next != uart_tail) {						// drop the byte when full
+		uart_rx[uart_head] = c;
+		uart_head = next;
+	}
+}
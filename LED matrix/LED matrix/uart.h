@@ -0,0 +1,43 @@
+/*
+ * uart.h
+ *
+ * Interrupt driven receive on USARTD0 (RX on PD2, TX on PD3), 8N1.
+ * Received bytes go into a ring buffer, the main loop takes them out with
+ * uart_getc(). The receive interrupt is low level, so it never delays the
+ * matrix refresh.
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+#include <stdint.h>
+#include "clock.h"
+
+#define UART				USARTD0
+#define UART_PORT			PORTD
+#define UART_TX_bm			PIN3_bm
+#define UART_RXC_vect		USARTD0_RXC_vect
+#define UART_BAUD			115200UL
+#define UART_RX_SIZE		256						// ring buffer, power of 2, at most 256
+
+/*
+ * Fractional baud rate with double speed: baud = F_CPU / (8 * (BSEL / 2^-BSCALE + 1)).
+ * An integer BSEL is 2.1 % off at 115200 baud and 32 MHz, BSCALE -5 brings
+ * that down to 0.01 %.
+ */
+#define UART_BSCALE			(-5)
+#define UART_BSEL			((32 * F_CPU + 4 * UART_BAUD) / (8 * UART_BAUD) - 32)
+
+#if UART_BSEL > 4095
+#error "UART_BAUD is too low for UART_BSCALE"
+#endif
+
+#if UART_RX_SIZE & (UART_RX_SIZE - 1) || UART_RX_SIZE > 256
+#error "UART_RX_SIZE must be a power of 2 up to 256"
+#endif
+
+void uart_init(void);
+int16_t uart_getc(void);
+void uart_putc(uint8_t c);
+
+#endif /* UART_H_ */
@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+"""
+Animation compiler for the LED matrix.
+
+Reads an animation source file (see anim.txt) and writes anim_data.c and
+anim_data.h with the animations packed in flash. The player is anim.c.
+Run it again after changing the animations:
+
+    python animc.py [anim.txt] [output directory] [--bits N]
+
+--bits must match MATRIX_BITS in matrix.h for grey animations (default 4).
+The width of the frames sets the number of modules, 8 columns each.
+
+Format of one animation, all numbers are bytes:
+
+    bits, modules, loop offset (2 bytes, little endian, 0 is no loop)
+    records: duration in matrix frames, frame
+    0
+
+A frame is bits planes of 8 rows of modules bytes, least significant plane
+and bottom row first. It is stored as it is when KEY is set in the
+duration. Else it is XORed with the frame before it, the first frame with
+an empty canvas, and run length coded: a control byte c followed by c + 1
+literal bytes when c < 0x80, or by one byte repeated c - 0x7F times. Each
+frame takes the shorter of the two. A looping animation starts again at
+the loop offset, the first record, on an empty canvas.
+
+The animations are never larger than with every frame stored as it is,
+and the compiler decodes its output again to check it.
+"""
+
+import os
+import re
+import sys
+
+HEIGHT = 8
+LEVELS = '0123456789ABCDEF'
+KEY = 0x80                  # duration flag of a frame stored as it is
+
+
+def parse(path, bits):
+    anims = []
+    anim = None
+    frame = None
+    for number, line in enumerate(open(path, encoding='utf-8'), 1):
+        line = line.strip()
+        if not line or line.startswith('#') and (frame is None or len(frame['rows']) == HEIGHT):
+            continue
+        where = '%s:%d' % (path, number)
+        words = line.split()
+        if words[0] == 'anim':
+            if len(words) not in (2, 3) or len(words) == 3 and words[2] != 'loop' \
+                    or not re.match(r'^[a-z_][a-z0-9_]*$', words[1]):
+                raise SystemExit('%s: expected "anim name [loop]"' % where)
+            anim = {'name': words[1], 'loop': len(words) == 3, 'frames': []}
+            anims.append(anim)
+            frame = None
+        elif words[0] == 'frame':
+            if anim is None or len(words) != 2 or not words[1].isdigit() or not 0 < int(words[1]) < KEY:
+                raise SystemExit('%s: expected "frame 1..%d" inside an animation' % (where, KEY - 1))
+            frame = {'duration': int(words[1]), 'rows': []}
+            anim['frames'].append(frame)
+        else:
+            if frame is None or len(frame['rows']) == HEIGHT:
+                raise SystemExit('%s: row outside a frame' % where)
+            line = line.upper()
+            if len(line) % 8 or set(line) - set('.#' + LEVELS):
+                raise SystemExit('%s: a row is 8 columns per module of ".", "#" or 0 to F' % where)
+            if frame['rows'] and len(line) != len(frame['rows'][0]):
+                raise SystemExit('%s: rows differ in width' % where)
+            frame['rows'].append(line)
+    for anim in anims:
+        if not anim['frames']:
+            raise SystemExit('%s: animation %s has no frames' % (path, anim['name']))
+        widths = set(len(row) for f in anim['frames'] for row in f['rows'])
+        if any(len(f['rows']) != HEIGHT for f in anim['frames']) or len(widths) != 1:
+            raise SystemExit('%s: frames of %s must all be %d rows of the same width' % (path, anim['name'], HEIGHT))
+        grey = any(set(row) - set('.#') for f in anim['frames'] for row in f['rows'])
+        anim['bits'] = bits if grey else 1
+        anim['modules'] = widths.pop() // 8
+    return anims
+
+
+def planes(rows, bits, modules):
+    full = (1 << bits) - 1
+    data = []
+    for b in range(bits):
+        for row in reversed(rows):
+            for m in range(modules):
+                byte = 0
+                for x, char in enumerate(row[m * 8:m * 8 + 8]):
+                    level = full if char == '#' else 0 if char == '.' else LEVELS.index(char)
+                    if level > full:
+                        raise SystemExit('grey level %s needs more than %d bits' % (char, bits))
+                    if level >> b & 1:
+                        byte |= 0x80 >> x
+                data.append(byte)
+    return data
+
+
+def rle(data):
+    out = []
+    i = 0
+    literal = []
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < 128:
+            run += 1
+        if run >= 3:
+            if literal:
+                out += [len(literal) - 1] + literal
+                literal = []
+            out += [0x7F + run, data[i]]
+            i += run
+        else:
+            literal.append(data[i])
+            i += 1
+            if len(literal) == 128:
+                out += [len(literal) - 1] + literal
+                literal = []
+    if literal:
+        out += [len(literal) - 1] + literal
+    return out
+
+
+def encode(anim):
+    frames = [planes(f['rows'], anim['bits'], anim['modules']) for f in anim['frames']]
+    durations = [f['duration'] for f in anim['frames']]
+    out = [anim['bits'], anim['modules'], 0, 0]
+    previous = [0] * len(frames[0])
+    for data, duration in zip(frames, durations):
+        delta = rle([a ^ b for a, b in zip(data, previous)])
+        if len(delta) < len(data):
+            out += [duration] + delta
+        else:
+            out += [duration | KEY] + data
+        previous = data
+    if anim['loop']:
+        out[2:4] = [4, 0]
+    out.append(0)
+    plain = 4 + sum(1 + len(f) for f in frames) + 1
+    if len(out) > plain or decode(out, len(frames[0])) != list(zip(durations, frames)):
+        raise SystemExit('animation %s does not encode' % anim['name'])
+    return out, plain
+
+
+def decode(data, size):
+    """The frames of one pass of data, played like anim.c does."""
+    frames = []
+    canvas = [0] * size
+    p = 4
+    while data[p]:
+        duration = data[p]
+        p += 1
+        if duration & KEY:
+            canvas = data[p:p + size]
+            p += size
+        else:
+            i = 0
+            while i < size:
+                c = data[p]
+                n = (c & 0x7F) + 1
+                if c & 0x80:
+                    canvas[i:i + n] = [v ^ data[p + 1] for v in canvas[i:i + n]]
+                    p += 2
+                else:
+                    canvas[i:i + n] = [v ^ d for v, d in zip(canvas[i:i + n], data[p + 1:p + 1 + n])]
+                    p += 1 + n
+                i += n
+        frames.append((duration & ~KEY, list(canvas)))
+    return frames
+
+
+def main():
+    args = [a for a in sys.argv[1:] if not a.startswith('--bits')]
+    bits = 4
+    for a in sys.argv[1:]:
+        if a.startswith('--bits'):
+            bits = int(a.split('=')[1])
+    here = os.path.dirname(os.path.abspath(__file__))
+    source = args[0] if len(args) > 0 else os.path.join(here, 'anim.txt')
+    output = args[1] if len(args) > 1 else os.path.join(here, 'LED matrix')
+    anims = parse(source, bits)
+
+    header = [
+        '/*',
+        ' * anim_data.h',
+        ' *',
+        ' * Generated by animc.py from %s, do not edit.' % os.path.basename(source),
+        ' */',
+        '',
+        '#ifndef ANIM_DATA_H_',
+        '#define ANIM_DATA_H_',
+        '',
+        '#include <stdint.h>',
+        '#include <avr/pgmspace.h>',
+        '',
+        '#define ANIM_COUNT\t%d' % len(anims),
+        '',
+    ]
+    for i, anim in enumerate(anims):
+        header.append('#define ANIM_%s\t%d' % (anim['name'].upper(), i))
+    header += [
+        '',
+        'extern const uint8_t * const anim_table[ANIM_COUNT] PROGMEM;',
+        '',
+        '#endif /* ANIM_DATA_H_ */',
+    ]
+
+    table = [
+        '/*',
+        ' * anim_data.c',
+        ' *',
+        ' * Generated by animc.py from %s, do not edit.' % os.path.basename(source),
+        ' */',
+        '',
+        '#include "anim_data.h"',
+    ]
+    for anim in anims:
+        data, plain = encode(anim)
+        table += [
+            '',
+            '// %s: %d frames, %d bit, %d module(s), %d bytes (%d as plain frames)' % (
+                anim['name'], len(anim['frames']), anim['bits'], anim['modules'], len(data), plain),
+            'static const uint8_t anim_%s[] PROGMEM = {' % anim['name'],
+        ]
+        for i in range(0, len(data), 12):
+            table.append('\t' + ' '.join('0x%02X,' % b for b in data[i:i + 12]))
+        table.append('};')
+    table += [
+        '',
+        'const uint8_t * const anim_table[ANIM_COUNT] PROGMEM = {',
+    ]
+    for anim in anims:
+        table.append('\tanim_%s,' % anim['name'])
+    table.append('};')
+
+    with open(os.path.join(output, 'anim_data.h'), 'w', encoding='utf-8', newline='\n') as f:
+        f.write('\n'.join(header) + '\n')
+    with open(os.path.join(output, 'anim_data.c'), 'w', encoding='utf-8', newline='\n') as f:
+        f.write('\n'.join(table) + '\n')
+
+
+if __name__ == '__main__':
+    main()
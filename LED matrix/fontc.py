@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""
+Font compiler for the LED matrix.
+
+Reads a glyph source file (see font.txt) and writes font.c and font.h with a
+proportional, column-major font in flash. Run it again after changing the
+glyphs:
+
+    python fontc.py [font.txt] [output directory]
+"""
+
+import os
+import sys
+
+FIRST = 0x20
+LAST = 0x7E
+MAX_WIDTH = 8
+HEIGHT = 8
+
+
+def parse(path):
+    glyphs = {}
+    char = None
+    rows = []
+    for number, line in enumerate(open(path, encoding='utf-8'), 1):
+        line = line.rstrip('\r\n')
+        if not line or line.startswith('#') and char is None:
+            continue
+        if line.startswith("'") and line.endswith("'") and len(line) == 3:
+            if char is not None:
+                raise SystemExit('%s:%d: glyph %r is incomplete' % (path, number, char))
+            char = line[1]
+            if char in glyphs:
+                raise SystemExit('%s:%d: glyph %r is defined twice' % (path, number, char))
+            rows = []
+            continue
+        if char is None or not 0 < len(line) <= MAX_WIDTH or set(line) - set('#.'):
+            raise SystemExit('%s:%d: expected 1 to %d characters of \'#\' or \'.\'' % (path, number, MAX_WIDTH))
+        if rows and len(line) != len(rows[0]):
+            raise SystemExit('%s:%d: rows of glyph %r differ in width' % (path, number, char))
+        rows.append(line)
+        if len(rows) == HEIGHT:
+            glyphs[char] = rows
+            char = None
+    if char is not None:
+        raise SystemExit('%s: glyph %r is incomplete' % (path, char))
+    missing = [chr(c) for c in range(FIRST, LAST + 1) if chr(c) not in glyphs]
+    if missing:
+        raise SystemExit('%s: missing glyphs %s' % (path, ' '.join(missing)))
+    return glyphs
+
+
+def columns(rows):
+    """One byte per column, left column first. Bit 0 is the bottom row."""
+    result = []
+    for x in range(len(rows[0])):
+        byte = 0
+        for y, row in enumerate(reversed(rows)):
+            if row[x] == '#':
+                byte |= 1 << y
+        result.append(byte)
+    if any(result):
+        while not result[0]:
+            result.pop(0)
+        while not result[-1]:
+            result.pop()
+    return result
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    source = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, 'font.txt')
+    output = sys.argv[2] if len(sys.argv) > 2 else os.path.join(here, 'LED matrix')
+    glyphs = parse(source)
+    packed = [(chr(c), columns(glyphs[chr(c)])) for c in range(FIRST, LAST + 1)]
+
+    header = [
+        '/*',
+        ' * font.h',
+        ' *',
+        ' * Generated by fontc.py from %s, do not edit.' % os.path.basename(source),
+        ' */',
+        '',
+        '#ifndef FONT_H_',
+        '#define FONT_H_',
+        '',
+        '#include <stdint.h>',
+        '#include <avr/pgmspace.h>',
+        '',
+        '#define FONT_FIRST\t\t0x%02X\t\t\t\t\t\t// first character in the table' % FIRST,
+        '#define FONT_LAST\t\t0x%02X\t\t\t\t\t\t// last character in the table' % LAST,
+        '#define FONT_MAX_WIDTH\t%d\t\t\t\t\t\t\t// columns of the widest glyph' % max(len(c) for _, c in packed),
+        '#define FONT_HEIGHT\t\t%d\t\t\t\t\t\t\t// rows per glyph' % HEIGHT,
+        '',
+        'extern const uint8_t font_columns[] PROGMEM;',
+        'extern const uint16_t font_offset[FONT_LAST - FONT_FIRST + 2] PROGMEM;',
+        '',
+        '/*',
+        ' * Index of c in font_offset. Characters outside the table show as \'?\'.',
+        ' */',
+        'static inline uint8_t font_index(char c)',
+        '{',
+        '\tif ((uint8_t)c < FONT_FIRST || (uint8_t)c > FONT_LAST)',
+        '\t\tc = \'?\';',
+        '\treturn (uint8_t)c - FONT_FIRST;',
+        '}',
+        '',
+        '/*',
+        ' * Returns the glyph of c in flash, one byte per column with the left',
+        ' * column first and bit 0 as the bottom row.',
+        ' */',
+        'static inline const uint8_t *font_glyph(char c)',
+        '{',
+        '\treturn font_columns + pgm_read_word(&font_offset[font_index(c)]);',
+        '}',
+        '',
+        '/*',
+        ' * Returns the number of columns of the glyph of c.',
+        ' */',
+        'static inline uint8_t font_width(char c)',
+        '{',
+        '\tuint8_t i = font_index(c);',
+        '',
+        '\treturn pgm_read_word(&font_offset[i + 1]) - pgm_read_word(&font_offset[i]);',
+        '}',
+        '',
+        '#endif /* FONT_H_ */',
+    ]
+
+    table = [
+        '/*',
+        ' * font.c',
+        ' *',
+        ' * Generated by fontc.py from %s, do not edit.' % os.path.basename(source),
+        ' */',
+        '',
+        '#include "font.h"',
+        '',
+        'const uint8_t font_columns[] PROGMEM = {',
+    ]
+    pad = 6 * max(len(c) for _, c in packed)
+    offsets = []
+    offset = 0
+    for char, cols in packed:
+        offsets.append(offset)
+        offset += len(cols)
+        table.append('\t%s\t// \'%s\'' % (' '.join('0x%02X,' % b for b in cols).ljust(pad), char))
+    offsets.append(offset)
+    table += [
+        '};',
+        '',
+        'const uint16_t font_offset[FONT_LAST - FONT_FIRST + 2] PROGMEM = {',
+    ]
+    for i in range(0, len(offsets), 8):
+        table.append('\t' + ' '.join('%d,' % o for o in offsets[i:i + 8]))
+    table.append('};')
+
+    with open(os.path.join(output, 'font.h'), 'w', encoding='utf-8', newline='\n') as f:
+        f.write('\n'.join(header) + '\n')
+    with open(os.path.join(output, 'font.c'), 'w', encoding='utf-8', newline='\n') as f:
+        f.write('\n'.join(table) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""
+Host tool for the LED matrix: sends command frames over a serial port.
+
+    python msgtool.py PORT message "HELLO WORLD"
+    python msgtool.py PORT append " AGAIN"
+    python msgtool.py PORT font 1          (0 proportional, 1 fixed width)
+    python msgtool.py PORT speed 5         (matrix frames per column)
+    python msgtool.py PORT brightness 128
+    python msgtool.py PORT play 0          (animation 0, 255 back to the text)
+
+PORT is a device such as COM3 or /dev/ttyUSB0, or a pyserial URL. With
+loop:// the frame comes straight back, which checks the framing without
+hardware. For a simulated port use a pty pair, for example
+"socat -d -d pty,raw,echo=0 pty,raw,echo=0", and point the tool at one
+end. The frame format is described in LED matrix/command.h.
+
+Needs pyserial.
+"""
+
+import argparse
+import sys
+
+import serial
+
+STX = 0x02
+ACK = 0x06
+NAK = 0x15
+BAUD = 115200
+MESSAGE_MAX = 127
+
+
+def frame(command, data):
+    if len(data) > 255:
+        raise ValueError('frame data longer than 255 bytes')
+    body = bytes([ord(command), len(data)]) + data
+    return bytes([STX]) + body + bytes([-sum(body) & 0xFF])
+
+
+def build(args):
+    if args.command in ('message', 'append'):
+        data = args.value.encode('ascii')
+        if len(data) > MESSAGE_MAX:
+            raise SystemExit('message longer than %d characters' % MESSAGE_MAX)
+        return frame('M' if args.command == 'message' else 'A', data)
+    value = int(args.value, 0)
+    limits = {'font': (0, 1), 'speed': (1, 255), 'brightness': (0, 255), 'play': (0, 255)}
+    low, high = limits[args.command]
+    if not low <= value <= high:
+        raise SystemExit('%s must be %d to %d' % (args.command, low, high))
+    return frame(args.command[0].upper(), bytes([value]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Send a command frame to the LED matrix.')
+    parser.add_argument('port')
+    parser.add_argument('command', choices=['message', 'append', 'font', 'speed', 'brightness', 'play'])
+    parser.add_argument('value')
+    parser.add_argument('--baud', type=int, default=BAUD)
+    parser.add_argument('--timeout', type=float, default=1.0, help='seconds to wait for the answer')
+    args = parser.parse_args()
+
+    data = build(args)
+    with serial.serial_for_url(args.port, args.baud, timeout=args.timeout) as port:
+        port.reset_input_buffer()
+        port.write(data)
+        if args.port.startswith('loop://'):
+            echo = port.read(len(data))
+            print('loopback %s: %s' % ('ok' if echo == data else 'failed', echo.hex(' ')))
+            return 0 if echo == data else 1
+        answer = port.read(1)
+    if answer == bytes([ACK]):
+        print('ACK')
+        return 0
+    print('NAK' if answer == bytes([NAK]) else 'no answer')
+    return 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,112 @@
+/*
+ * bench.c
+ *
+ * Cycle counter and result output of the benchmark images, see bench.h.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "trace.h"
+
+#if TRACE==1
+#error "the cycle counter and the USART are those of trace.c, build the benchmarks with TRACE 0"
+#endif
+
+static uint32_t bench_overhead = 0;					// cycles of an empty measurement
+
+/*
+ * Starts the cycle counter and the USART and measures the cost of
+ * bench_start() and bench_stop() themselves.
+ */
+void bench_init(void)
+{
+	uint32_t t;
+
+	BENCH_EVMUX = BENCH_EVMUX_gc;
+	BENCH_TC_HI.CTRLA = BENCH_HI_CLKSEL;
+	BENCH_TC_LO.CTRLA = TC_CLKSEL_DIV1_gc;
+
+	BENCH_UART_PORT.OUTSET = BENCH_UART_TX_bm;		// idle high
+	BENCH_UART_PORT.DIRSET = BENCH_UART_TX_bm;
+	BENCH_UART.BAUDCTRLA = BENCH_BSEL & 0xFF;
+	BENCH_UART.BAUDCTRLB = BENCH_BSEL >> 8;
+	BENCH_UART.CTRLC = USART_CHSIZE_8BIT_gc;
+	BENCH_UART.CTRLB = USART_TXEN_bm | USART_CLK2X_bm;
+
+	t = bench_start();
+	bench_overhead = bench_stop(t);
+}
+
+/*
+ * Returns the cycle counter. The high half is clocked through the event
+ * system a few cycles after the low half wraps, so a low half just past
+ * the wrap is not trusted and read again.
+ */
+uint32_t bench_now(void)
+{
+	uint16_t hi, lo;
+
+	do {
+		hi = BENCH_TC_HI.CNT;
+		lo = BENCH_TC_LO.CNT;
+	} while (lo < 16 || hi != BENCH_TC_HI.CNT);
+
+	return ((uint32_t)hi << 16) | lo;
+}
+
+uint32_t bench_start(void)
+{
+	return bench_now();
+}
+
+/*
+ * Returns the cycles since start, without the cost of the measurement.
+ */
+uint32_t bench_stop(uint32_t start)
+{
+	return bench_now() - start - bench_overhead;
+}
+
+static void bench_putc(char c)
+{
+	while (!(BENCH_UART.STATUS & USART_DREIF_bm));
+	BENCH_UART.DATA = c;
+	BENCH_UART.STATUS = USART_TXCIF_bm;				// set again when c is out
+}
+
+static void bench_puts(const char *s)
+{
+	while (*s)
+		bench_putc(*s++);
+}
+
+void bench_report(const char *name, uint32_t value, const char *unit)
+{
+	char number[11];
+
+	ultoa(value, number, 10);
+	bench_puts("BENCH ");
+	bench_puts(name);
+	bench_putc(' ');
+	bench_puts(number);
+	bench_putc(' ');
+	bench_puts(unit);
+	bench_puts("\r\n");
+}
+
+/*
+ * Waits until the last byte is sent and sleeps with the interrupts
+ * disabled, which ends a simulator run.
+ */
+void bench_done(void)
+{
+	while (!(BENCH_UART.STATUS & USART_TXCIF_bm));
+	cli();
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	sleep_enable();
+	for (;;)
+		sleep_cpu();
+}
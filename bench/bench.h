@@ -0,0 +1,38 @@
+/*
+ * bench.h
+ *
+ * Cycle counter and result output of the benchmark images, see Makefile.
+ *
+ * TCC1 counts the CPU clock and its overflow clocks TCD0 through event
+ * channel 7, together a 32 bit cycle counter. The drivers under test do
+ * not use these timers (the scheduler is not linked in).
+ * The results go out on USARTC0 (TX on PC3, 115200 baud, 8N1) as lines
+ * "BENCH <name> <value> <unit>", blocking, outside the measurements.
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include "clock.h"
+
+#define BENCH_TC_LO			TCC1					// counts F_CPU
+#define BENCH_TC_HI			TCD0					// counts overflows of BENCH_TC_LO
+#define BENCH_EVMUX			EVSYS.CH7MUX
+#define BENCH_EVMUX_gc		EVSYS_CHMUX_TCC1_OVF_gc
+#define BENCH_HI_CLKSEL		TC_CLKSEL_EVCH7_gc
+
+#define BENCH_UART			USARTC0
+#define BENCH_UART_PORT		PORTC
+#define BENCH_UART_TX_bm	PIN3_bm
+#define BENCH_BAUD			115200UL
+#define BENCH_BSEL			((F_CPU + 4 * BENCH_BAUD) / (8 * BENCH_BAUD) - 1)	// double speed
+
+void bench_init(void);
+uint32_t bench_now(void);
+uint32_t bench_start(void);
+uint32_t bench_stop(uint32_t start);
+void bench_report(const char *name, uint32_t value, const char *unit);
+void bench_done(void) __attribute__((noreturn));
+
+#endif /* BENCH_H_ */
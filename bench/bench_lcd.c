@@ -0,0 +1,135 @@
+/*
+ * bench_lcd.c
+ *
+ * Cycles of the LCD driver and of the SPI driver of the LCD project, in
+ * the mode set in lcd.h or by LCD_FLAGS of the Makefile.
+ *
+ * For every LCD operation two numbers are reported: <name> until the
+ * function returns and <name>_done until the LCD has executed the last
+ * byte (with LCD_QUEUE 1 the difference is sent by the interrupt). The
+ * times without the busy flag do not depend on the LCD, with the busy
+ * flag a display must be connected.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <string.h>
+#include "bench.h"
+#include "lcd.h"
+#include "Spi.h"
+
+#define BENCH_SPI_BYTES	64
+
+static lcd_t bench_lcd_panel;					// 16x2 display on the E line of lcd.h
+static char bench_line[] = "0123456789ABCDEF";
+static uint8_t bench_tx[BENCH_SPI_BYTES];
+static uint8_t bench_rx[BENCH_SPI_BYTES];
+
+/*
+ * Waits until the LCD has executed everything that was written.
+ */
+static void lcd_done(void)
+{
+#if LCD_QUEUE==1
+	lcd_flush(&bench_lcd_panel);
+#endif
+}
+
+/*
+ * Reports the cycles of one LCD operation, divided by n. Both times are
+ * taken before the first report goes out.
+ */
+static void report_lcd(const char *name, uint32_t start, uint8_t n)
+{
+	char done_name[32];
+	uint32_t t = bench_stop(start);
+	uint32_t done;
+
+	lcd_done();
+	done = bench_stop(start);
+	bench_report(name, t / n, "cycles");
+	strcpy(done_name, name);
+	strcat(done_name, "_done");
+	bench_report(done_name, done / n, "cycles");
+}
+
+static void bench_lcd(void)
+{
+	uint32_t t;
+
+	t = bench_start();
+	lcd_init(&bench_lcd_panel, &LCD_E_PORT, LCD_E_bp, 2, 16);
+	sei();
+	report_lcd("lcd_init", t, 1);
+
+	t = bench_start();
+	lcd_putc(&bench_lcd_panel, 'x');
+	report_lcd("lcd_putc", t, 1);
+
+	t = bench_start();
+	lcd_puts(&bench_lcd_panel, bench_line);
+	report_lcd("lcd_puts_per_char", t, sizeof(bench_line) - 1);
+
+	t = bench_start();
+	lcd_gotoxy(&bench_lcd_panel, 3, 1);
+	report_lcd("lcd_gotoxy", t, 1);
+
+	t = bench_start();
+	lcd_clear(&bench_lcd_panel);
+	report_lcd("lcd_clear", t, 1);
+
+#if LCD_FRAMEBUFFER==1
+	lcd_fb_clear(&bench_lcd_panel);
+	lcd_fb_puts(&bench_lcd_panel, bench_line);
+	t = bench_start();
+	lcd_fb_flush(&bench_lcd_panel);
+	report_lcd("lcd_fb_flush_line", t, 1);
+
+	lcd_fb_gotoxy(&bench_lcd_panel, 8, 0);
+	lcd_fb_putc(&bench_lcd_panel, 'x');
+	t = bench_start();
+	lcd_fb_flush(&bench_lcd_panel);
+	report_lcd("lcd_fb_flush_char", t, 1);
+
+	t = bench_start();
+	lcd_fb_flush(&bench_lcd_panel);
+	report_lcd("lcd_fb_flush_none", t, 1);
+#endif
+}
+
+static void bench_spi(void)
+{
+	spi_xfer_t xfer = { bench_tx, bench_rx, BENCH_SPI_BYTES, NULL, 0, 0, NULL };
+	uint32_t t, submit, done;
+
+	spi_init(F_CPU / 2);
+
+	t = bench_start();
+	for (uint8_t i = 0; i < BENCH_SPI_BYTES; i++)
+		spi_transfer(bench_tx[i]);
+	bench_report("spi_transfer_per_byte", bench_stop(t) / BENCH_SPI_BYTES, "cycles");
+
+	t = bench_start();
+	spi_transfer_block(bench_tx, bench_rx, BENCH_SPI_BYTES);
+	bench_report("spi_transfer_block_per_byte", bench_stop(t) / BENCH_SPI_BYTES, "cycles");
+
+	t = bench_start();
+	spi_submit(&xfer);
+	submit = bench_stop(t);
+	while (!xfer.done)
+		bench_now();							// spi_wait() that lets host/sim.cpp run
+	done = bench_stop(t);
+	bench_report("spi_submit", submit, "cycles");
+	bench_report("spi_submit_per_byte_done", done / BENCH_SPI_BYTES, "cycles");
+}
+
+int main(void)
+{
+	clock_init();
+	bench_init();
+
+	bench_lcd();
+	bench_spi();
+
+	bench_done();
+}
@@ -0,0 +1,84 @@
+/*
+ * bench_matrix.c
+ *
+ * Cycles of the LED matrix drawing functions and of the refresh
+ * interrupt, in the configuration of matrix.h.
+ *
+ * The drawing functions are measured with the interrupts disabled. The
+ * refresh is measured by counting the turns of an idle loop over ten
+ * frames, once without and once with the refresh interrupts. The turns
+ * the interrupts take away are their share of the CPU.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "bench.h"
+#include "matrix.h"
+#include "text.h"
+#include "Spi.h"
+
+#define BENCH_FRAME		(F_CPU / MATRIX_FRAME_HZ)	// cycles of one frame
+#define BENCH_FRAMES	10							// frames of the idle loop
+
+/*
+ * Returns the turns of the idle loop in cycles.
+ */
+static uint32_t idle_turns(uint32_t cycles)
+{
+	uint32_t start = bench_now();
+	uint32_t turns = 0;
+
+	while (bench_now() - start < cycles)
+		turns++;
+	return turns;
+}
+
+static void bench_draw(void)
+{
+	text_t text;
+	uint32_t t;
+
+	t = bench_start();
+	for (uint8_t y = 0; y < MATRIX_ROWS; y++)
+		for (uint8_t x = 0; x < MATRIX_WIDTH; x++)
+			matrix_set(x, y, x & (MATRIX_LEVELS - 1));
+	bench_report("matrix_set", bench_stop(t) / (MATRIX_ROWS * MATRIX_WIDTH), "cycles");
+
+	text_start(&text, "Benchmark");
+	t = bench_start();
+	for (uint8_t i = 0; i < 64; i++)
+		text_column(&text);
+	bench_report("text_column", bench_stop(t) / 64, "cycles");
+
+	t = bench_start();
+	matrix_scroll(0x55);
+	bench_report("matrix_scroll", bench_stop(t), "cycles");
+}
+
+static void bench_refresh(void)
+{
+	uint32_t idle, busy, per_frame;
+
+	cli();
+	idle = idle_turns(BENCH_FRAMES * BENCH_FRAME);
+	sei();
+	busy = idle_turns(BENCH_FRAMES * BENCH_FRAME);
+
+	per_frame = (uint32_t)((uint64_t)BENCH_FRAME * (idle - busy) / idle);
+	bench_report("matrix_refresh_per_frame", per_frame, "cycles");
+	bench_report("matrix_refresh_per_push", per_frame / (MATRIX_ROWS * MATRIX_BITS), "cycles");
+	bench_report("matrix_refresh_load", (uint32_t)(10000ULL * (idle - busy) / idle), "1e-4");
+}
+
+int main(void)
+{
+	clock_init();
+	bench_init();
+	spi_init(F_CPU / 2);
+	matrix_init();
+
+	bench_draw();
+	bench_refresh();
+
+	bench_done();
+}
@@ -0,0 +1,226 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "Spi.h"
+#include "trace.h"
+
+static spi_xfer_t * volatile spi_head = NULL;		// transfer in progress
+static spi_xfer_t *spi_tail = NULL;					// last submitted transfer
+static uint16_t spi_pos;							// bytes done of spi_head
+
+/*
+ * SPI clock dividers from fast to slow: CLK2X and the prescaler.
+ */
+static const uint8_t spi_prescaler[] = {
+	SPI_CLK2X_bm | SPI_PRESCALER_DIV4_gc,			// F_CPU/2
+	SPI_PRESCALER_DIV4_gc,							// F_CPU/4
+	SPI_CLK2X_bm | SPI_PRESCALER_DIV16_gc,			// F_CPU/8
+	SPI_PRESCALER_DIV16_gc,							// F_CPU/16
+	SPI_CLK2X_bm | SPI_PRESCALER_DIV64_gc,			// F_CPU/32
+	SPI_PRESCALER_DIV64_gc,							// F_CPU/64
+	SPI_PRESCALER_DIV128_gc							// F_CPU/128
+};
+
+/*
+ * Initializes the SPI master with the fastest clock that is not above
+ * freq. Returns the SPI clock frequency that is used.
+ */
+uint32_t spi_init(uint32_t freq)
+{
+	uint32_t f = F_CPU / 2;
+	uint8_t i = 0;
+
+	while ( (f > freq) && (i < sizeof(spi_prescaler) - 1) ) {
+		f >>= 1;
+		i++;
+	}
+
+	PORTC.DIR |= SPI_SCK_bm|SPI_MOSI_bm|SPI_SS_bm;
+	SPIC.CTRL = spi_prescaler[i] |				// clock divider
+	SPI_ENABLE_bm |								// SPI enable
+	(!SPI_DORD_bm) |							// data order;: MSB first
+	SPI_MASTER_bm |								// master
+	SPI_MODE_0_gc;								// mode 0
+#if SPI_FAST_IO==1
+	PORTCFG.VPCTRLB = (PORTCFG.VPCTRLB & ~PORTCFG_VP2MAP_gm) | SPI_VPMAP;
+#endif
+#if SPI_USE_DMA==1
+	DMA.CTRL = DMA_ENABLE_bm | DMA_PRIMODE_CH0123_gc;	// channel 0 before 1
+#endif
+	PMIC.CTRL |= SPI_PMIC_bm;
+
+	return f;
+}
+
+/*
+ * Blocking transfers can not run while the interrupt driven queue is
+ * busy, they wait until it is empty. See SPI_INTLVL for the interrupts.
+ */
+uint8_t spi_transfer(uint8_t data)
+{
+	TRACE_BEGIN(TRACE_SPI);
+	while (spi_head != NULL);
+	SPIC.DATA = data;
+	while ( ! (SPIC.STATUS & (SPI_IF_bm)) );
+	data = SPIC.DATA;
+	TRACE_END(TRACE_SPI);
+	
+	return data;
+}
+
+void spi_transfer_block(const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+	uint8_t data;
+
+	TRACE_BEGIN(TRACE_SPI_BLOCK);
+	while (spi_head != NULL);
+	while (len--) {
+		SPIC.DATA = tx ? *tx++ : SPI_DUMMY;
+		while ( ! (SPIC.STATUS & (SPI_IF_bm)) );
+		data = SPIC.DATA;
+		if (rx) *rx++ = data;
+	}
+	TRACE_END(TRACE_SPI_BLOCK);
+}
+
+#if SPI_USE_DMA==1
+static void spi_dma_addr(volatile register8_t *addr, const volatile void *p)
+{
+	addr[0] = (uint16_t)(uintptr_t)p & 0xFF;
+	addr[1] = (uint16_t)(uintptr_t)p >> 8;
+	addr[2] = (uint32_t)(uintptr_t)p >> 16 & 0xFF;	// 0 in the 16 bit data space
+}
+
+static const uint8_t spi_dma_dummy = SPI_DUMMY;		// source without transmit buffer
+static uint8_t spi_dma_sink;						// destination without receive buffer
+
+/*
+ * Channel 0 reads SPIC.DATA after every byte, channel 1 writes the next
+ * byte. Both are triggered by the SPI interrupt flag; with fixed priority
+ * channel 0 runs first. The first byte is written by the CPU, after both
+ * channels are armed, or its received byte would be overwritten unread.
+ */
+static void spi_dma_start(spi_xfer_t *x)
+{
+	DMA.CH0.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_FIXED_gc |
+	                   DMA_CH_DESTRELOAD_NONE_gc | (x->rx ? DMA_CH_DESTDIR_INC_gc : DMA_CH_DESTDIR_FIXED_gc);
+	DMA.CH0.TRIGSRC  = DMA_CH_TRIGSRC_SPIC_gc;
+	DMA.CH0.TRFCNT   = x->len;
+	spi_dma_addr(&DMA.CH0.SRCADDR0, &SPIC.DATA);
+	spi_dma_addr(&DMA.CH0.DESTADDR0, x->rx ? x->rx : &spi_dma_sink);
+	DMA.CH0.CTRLB    = SPI_DMA_INTLVL;
+	DMA.CH0.CTRLA    = DMA_CH_ENABLE_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+
+	if (x->len > 1) {
+		DMA.CH1.ADDRCTRL = (x->tx ? DMA_CH_SRCDIR_INC_gc : DMA_CH_SRCDIR_FIXED_gc) | DMA_CH_SRCRELOAD_NONE_gc |
+		                   DMA_CH_DESTRELOAD_NONE_gc | DMA_CH_DESTDIR_FIXED_gc;
+		DMA.CH1.TRIGSRC  = DMA_CH_TRIGSRC_SPIC_gc;
+		DMA.CH1.TRFCNT   = x->len - 1;
+		spi_dma_addr(&DMA.CH1.SRCADDR0, x->tx ? x->tx + 1 : &spi_dma_dummy);
+		spi_dma_addr(&DMA.CH1.DESTADDR0, &SPIC.DATA);
+		DMA.CH1.CTRLB    = 0;
+		DMA.CH1.CTRLA    = DMA_CH_ENABLE_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+	}
+	SPIC.DATA = x->tx ? x->tx[0] : SPI_DUMMY;
+}
+#endif
+
+/*
+ * Starts spi_head. Called with interrupts disabled or from an interrupt.
+ */
+static void spi_start(void)
+{
+	spi_xfer_t *x = spi_head;
+
+	if (x->cs_port) x->cs_port->OUTCLR = x->cs_bm;
+	spi_pos = 0;
+#if SPI_USE_DMA==1
+	if (x->len > 0) {
+		spi_dma_start(x);
+		return;
+	}
+#else
+	if (x->len > 0) {
+		SPIC.INTCTRL = SPI_INTLVL;
+		SPIC.DATA = x->tx ? x->tx[0] : SPI_DUMMY;
+		return;
+	}
+#endif
+	if (x->cs_port) x->cs_port->OUTSET = x->cs_bm;
+	x->done = 1;
+	spi_head = x->next;
+	if (spi_head != NULL) spi_start();
+}
+
+/*
+ * Completes spi_head and starts the next submitted transfer.
+ */
+static void spi_finish(void)
+{
+	spi_xfer_t *x = spi_head;
+
+	if (x->cs_port) x->cs_port->OUTSET = x->cs_bm;
+	x->done = 1;
+	spi_head = x->next;
+	if (spi_head != NULL) {
+		spi_start();
+	} else {
+		SPIC.INTCTRL = SPI_INTLVL_OFF_gc;
+	}
+}
+
+/*
+ * Queues a transfer. It runs in the background and sets xfer->done when
+ * it is complete. The buffers must stay valid until then.
+ */
+void spi_submit(spi_xfer_t *xfer)
+{
+	uint8_t sreg;
+
+	xfer->done = 0;
+	xfer->next = NULL;
+
+	sreg = SREG;
+	cli();
+	if (spi_head == NULL) {
+		spi_head = xfer;
+		spi_tail = xfer;
+		spi_start();
+	} else {
+		spi_tail->next = xfer;
+		spi_tail = xfer;
+	}
+	SREG = sreg;
+}
+
+uint8_t spi_idle(void)
+{
+	return spi_head == NULL;
+}
+
+void spi_wait(spi_xfer_t *xfer)
+{
+	while (!xfer->done);
+}
+
+#if SPI_USE_DMA==1
+ISR(DMA_CH0_vect)
+{
+	DMA.CH0.CTRLB |= DMA_CH_TRNIF_bm;				// clear flag
+	spi_finish();
+}
+#else
+ISR(SPIC_INT_vect)
+{
+	spi_xfer_t *x = spi_head;
+	uint8_t data = SPIC.DATA;
+
+	if (x->rx) x->rx[spi_pos] = data;
+	if (++spi_pos < x->len) {
+		SPIC.DATA = x->tx ? x->tx[spi_pos] : SPI_DUMMY;
+	} else {
+		spi_finish();
+	}
+}
+#endif
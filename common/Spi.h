@@ -0,0 +1,69 @@
+#include "clock.h"
+#define SPI_SS_bm 0x10								// SS pin 4
+#define SPI_MOSI_bm 0x20							// DATA pin 5
+#define SPI_SCK_bm	0x80							// Clock pin 7 
+
+#define SPI_FAST_IO 0								// 1: PORTC via virtual port (sbi/cbi)
+#define SPI_VPORT	VPORT2							// virtual port for PORTC
+#define SPI_VPMAP	PORTCFG_VP2MAP_PORTC_gc			// maps PORTC on SPI_VPORT
+
+#if SPI_FAST_IO==1
+#define SPI_PORT_OUT	SPI_VPORT.OUT
+#define SPI_SS_LOW()	(SPI_VPORT.OUT &= (uint8_t)~SPI_SS_bm)
+#define SPI_SS_HIGH()	(SPI_VPORT.OUT |= SPI_SS_bm)
+#else
+#define SPI_PORT_OUT	PORTC.OUT
+#define SPI_SS_LOW()	(PORTC.OUTCLR = SPI_SS_bm)
+#define SPI_SS_HIGH()	(PORTC.OUTSET = SPI_SS_bm)
+#endif
+
+#ifndef SPI_USE_DMA
+#define SPI_USE_DMA 0								// 1: async transfers via DMA channel 0 and 1
+#endif
+#define SPI_DUMMY	0x00							// byte sent when there is no transmit buffer
+
+/*
+ * The queue of spi_submit() completes its transfers in the SPI or DMA
+ * interrupt at level SPI_INTLVL. The blocking calls wait until the queue
+ * is empty, so an interrupt of that level or higher must not call them
+ * while transfers may be queued: the queue could never finish.
+ * The LCD project keeps the default low level of its other interrupts.
+ * The LED matrix builds with SPI_USE_DMA 1 and SPI_LEVEL 2, medium like
+ * the refresh, so low level interrupts can not delay a latch.
+ */
+#ifndef SPI_LEVEL
+#define SPI_LEVEL		1							// 1 low, 2 medium, 3 high
+#endif
+
+#if SPI_LEVEL==1
+#define SPI_INTLVL		SPI_INTLVL_LO_gc
+#define SPI_DMA_INTLVL	DMA_CH_TRNINTLVL_LO_gc
+#define SPI_PMIC_bm		PMIC_LOLVLEN_bm
+#elif SPI_LEVEL==2
+#define SPI_INTLVL		SPI_INTLVL_MED_gc
+#define SPI_DMA_INTLVL	DMA_CH_TRNINTLVL_MED_gc
+#define SPI_PMIC_bm		PMIC_MEDLVLEN_bm
+#elif SPI_LEVEL==3
+#define SPI_INTLVL		SPI_INTLVL_HI_gc
+#define SPI_DMA_INTLVL	DMA_CH_TRNINTLVL_HI_gc
+#define SPI_PMIC_bm		PMIC_HILVLEN_bm
+#else
+#error "SPI_LEVEL must be 1, 2 or 3"
+#endif
+
+typedef struct spi_xfer {
+	const uint8_t *tx;								// bytes to send, NULL sends SPI_DUMMY
+	uint8_t *rx;									// received bytes, NULL discards them
+	uint16_t len;									// number of bytes
+	PORT_t *cs_port;								// chip select port, NULL is no chip select
+	uint8_t cs_bm;									// chip select pin (active low)
+	volatile uint8_t done;							// 1 when the transfer is complete
+	struct spi_xfer *next;							// used by the driver
+} spi_xfer_t;
+
+uint32_t spi_init(uint32_t freq);
+uint8_t spi_transfer(uint8_t data);
+void spi_transfer_block(const uint8_t *tx, uint8_t *rx, uint16_t len);
+void spi_submit(spi_xfer_t *xfer);
+uint8_t spi_idle(void);
+void spi_wait(spi_xfer_t *xfer);
\ No newline at end of file
@@ -0,0 +1,26 @@
+/*
+ * clock.c
+ *
+ * Switches the system clock from the 2 MHz to the 32 MHz internal
+ * oscillator. The DFLL keeps the 32 MHz oscillator calibrated against
+ * the internal 32.768 kHz oscillator.
+ */
+
+#include <avr/io.h>
+#include "clock.h"
+
+void clock_init(void)
+{
+	OSC.CTRL |= OSC_RC32MEN_bm | OSC_RC32KEN_bm;		// enable 32 MHz and 32.768 kHz oscillator
+	while ( ! (OSC.STATUS & OSC_RC32MRDY_bm) );
+	while ( ! (OSC.STATUS & OSC_RC32KRDY_bm) );
+
+	OSC.DFLLCTRL = (OSC.DFLLCTRL & ~OSC_RC32MCREF_gm) |	// DFLL reference is
+	               OSC_RC32MCREF_RC32K_gc;				// the 32.768 kHz oscillator
+	DFLLRC32M.CTRL = DFLL_ENABLE_bm;
+
+	CCP = CCP_IOREG_gc;									// protected register
+	CLK.CTRL = CLK_SCLKSEL_RC32M_gc;					// system clock 32 MHz
+
+	OSC.CTRL &= ~OSC_RC2MEN_bm;							// 2 MHz oscillator off
+}
@@ -0,0 +1,23 @@
+/*
+ * clock.h
+ *
+ * System clock: the 32 MHz internal oscillator, calibrated by the DFLL
+ * against the internal 32.768 kHz oscillator.
+ * Include this file before <util/delay.h>, so all delays and timer
+ * settings are derived from the real clock.
+ */
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#ifndef F_CPU
+#define F_CPU 32000000UL
+#endif
+
+#if F_CPU != 32000000UL
+#error "clock_init() sets the system clock to 32 MHz"
+#endif
+
+void clock_init(void);
+
+#endif /* CLOCK_H_ */
@@ -0,0 +1,141 @@
+/*
+ * sched.c
+ *
+ * Cooperative scheduler with run time accounting, see sched.h.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <stddef.h>
+#include "sched.h"
+
+static sched_task_t sched_tasks[SCHED_MAX_TASKS];
+static uint8_t sched_count = 0;
+static volatile uint32_t sched_tick = 0;			// ticks since start, wraps after 49 days
+
+void sched_init(void)
+{
+	SCHED_TC.PER = SCHED_COUNTS - 1;
+	SCHED_TC.INTCTRLA = TC_OVFINTLVL_LO_gc;
+	SCHED_TC.CTRLA = SCHED_TC_CLKSEL;
+	PMIC.CTRL |= PMIC_LOLVLEN_bm;
+}
+
+/*
+ * Adds a task that is first released at the next tick. Returns its id,
+ * or 0xFF when the table is full.
+ */
+uint8_t sched_add(void (*run)(void), uint16_t period, uint16_t deadline)
+{
+	sched_task_t *t;
+
+	if (sched_count == SCHED_MAX_TASKS)
+		return 0xFF;
+	t = &sched_tasks[sched_count];
+	t->run = run;
+	t->period = period;
+	t->deadline = deadline;
+	t->release = sched_ticks() + 1;
+	t->runs = 0;
+	t->misses = 0;
+	t->total = 0;
+	t->longest = 0;
+	return sched_count++;
+}
+
+uint16_t sched_ticks(void)
+{
+	uint16_t now;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		now = sched_tick;
+	}
+	return now;
+}
+
+/*
+ * Ticks since start for times longer than the 65 s of sched_ticks().
+ */
+uint32_t sched_time(void)
+{
+	uint32_t now;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		now = sched_tick;
+	}
+	return now;
+}
+
+const sched_task_t *sched_task(uint8_t id)
+{
+	return id < sched_count ? &sched_tasks[id] : NULL;
+}
+
+/*
+ * Time in timer counts, wraps around with the tick. Counts an overflow
+ * that is pending but not handled yet.
+ */
+static uint32_t sched_stamp(void)
+{
+	uint16_t tick, count;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		tick = sched_tick;
+		count = SCHED_TC.CNT;
+		if (SCHED_TC.INTFLAGS & TC1_OVFIF_bm) {
+			tick++;
+			count = SCHED_TC.CNT;
+		}
+	}
+	return (uint32_t)tick * SCHED_COUNTS + count;
+}
+
+/*
+ * Runs the tasks forever. Each pass runs the first released task and
+ * starts again from the top. A task that fell more than a period behind
+ * skips the missed releases instead of running back to back.
+ */
+void sched_run(void)
+{
+	while (1)
+	{
+		uint16_t now = sched_ticks();
+
+		for (uint8_t i = 0; i < sched_count; i++)
+		{
+			sched_task_t *t = &sched_tasks[i];
+			uint32_t start, used;
+
+			if ((int16_t)(now - t->release) < 0)
+				continue;
+
+			start = sched_stamp();
+			t->run();
+			used = sched_stamp();
+			if (used < start)
+				used += 65536UL * SCHED_COUNTS;			// tick wrapped
+			used -= start;
+
+			t->runs++;
+			t->total += used;
+			if (used > t->longest)
+				t->longest = used > 0xFFFF ? 0xFFFF : used;
+			if ((uint16_t)(sched_ticks() - t->release) > t->deadline)
+				t->misses++;
+
+			t->release += t->period;
+			if ((int16_t)(sched_ticks() - t->release) >= 0)
+				t->release = sched_ticks() + t->period;
+			break;
+		}
+	}
+}
+
+ISR(SCHED_TC_OVF_vect)
+{
+	sched_tick++;
+}
@@ -0,0 +1,46 @@
+/*
+ * sched.h
+ *
+ * Cooperative scheduler on a 1 ms tick. Each task is a function that runs
+ * to completion, released every period ticks. Tasks are checked in the
+ * order they were added, so the first task has the highest priority.
+ * A run that ends more than deadline ticks after its release counts as
+ * a miss. The run time of every task is measured in timer counts of
+ * SCHED_US_PER_COUNT us.
+ * The three projects build this one copy, like clock.c, trace.c and Spi.c.
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include <stdint.h>
+#include "clock.h"
+
+#define SCHED_TC			TCC1					// timer for the tick
+#define SCHED_TC_OVF_vect	TCC1_OVF_vect
+#define SCHED_TC_CLKSEL		TC_CLKSEL_DIV64_gc
+#define SCHED_TC_DIV		64
+#define SCHED_TICK_HZ		1000
+#define SCHED_COUNTS		(F_CPU / SCHED_TC_DIV / SCHED_TICK_HZ)	// timer counts per tick
+#define SCHED_US_PER_COUNT	(1000000UL * SCHED_TC_DIV / F_CPU)
+#define SCHED_MAX_TASKS		8
+
+typedef struct {
+	void (*run)(void);								// task function
+	uint16_t period;								// ticks between releases
+	uint16_t deadline;								// ticks from release to the end of the run
+	uint16_t release;								// tick of the next release
+	uint16_t runs;									// completed runs
+	uint16_t misses;								// runs that ended after the deadline
+	uint32_t total;									// counts spent in the task
+	uint16_t longest;								// counts of the longest run
+} sched_task_t;
+
+void sched_init(void);
+uint8_t sched_add(void (*run)(void), uint16_t period, uint16_t deadline);
+void sched_run(void);
+uint16_t sched_ticks(void);
+uint32_t sched_time(void);
+const sched_task_t *sched_task(uint8_t id);
+
+#endif /* SCHED_H_ */
@@ -0,0 +1,130 @@
+/*
+ * trace.c
+ *
+ * Event ring buffer with timer timestamps, drained on the USART, see
+ * trace.h.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "trace.h"
+
+#if TRACE==1
+
+#define TRACE_RECORD	3							// bytes of a record
+
+static uint8_t trace_ring[TRACE_SIZE][TRACE_RECORD];	// event, time low, time high
+static volatile uint8_t trace_head = 0;				// next free record, changed by trace_event
+static volatile uint8_t trace_tail = 0;				// oldest record, changed by the interrupt
+static uint16_t trace_lost = 0;						// records dropped since the last TRACE_LOST
+
+static uint8_t trace_header[2];						// of the frame being sent
+static uint8_t trace_sent = sizeof(trace_header);	// bytes of the header sent, all is no frame
+static uint8_t trace_left = 0;						// records of the frame to send
+static uint8_t trace_byte = 0;						// next byte of the record at trace_tail
+
+void trace_init(void)
+{
+	TRACE_TC.PER = 0xFFFF;
+	TRACE_TC.CTRLA = TRACE_TC_CLKSEL;
+
+	TRACE_USART_PORT.DIRSET = TRACE_USART_TX_bm;
+	TRACE_USART_PORT.OUTSET = TRACE_USART_TX_bm;	// idle high
+	TRACE_USART.BAUDCTRLA = TRACE_BSEL & 0xFF;
+	TRACE_USART.BAUDCTRLB = TRACE_BSEL >> 8;
+	TRACE_USART.CTRLC = USART_CHSIZE_8BIT_gc;
+	TRACE_USART.CTRLB = USART_TXEN_bm | USART_CLK2X_bm;
+	PMIC.CTRL |= PMIC_LOLVLEN_bm;
+}
+
+static inline void trace_store(uint8_t head, uint8_t event, uint16_t time)
+{
+	trace_ring[head][0] = event;
+	trace_ring[head][1] = time & 0xFF;
+	trace_ring[head][2] = time >> 8;
+}
+
+/*
+ * Records event with the time and starts the sending. Also called from
+ * interrupts, so the interrupts are disabled for the few cycles it takes.
+ * A full ring drops the new record; a TRACE_LOST record with the number
+ * of dropped records goes in first when there is room again, so the
+ * decoder knows where the gap is.
+ */
+void trace_event(uint8_t event)
+{
+	uint8_t sreg = SREG;
+	uint8_t head;
+	uint16_t time;
+
+	cli();
+	time = TRACE_TC.CNT;
+	head = trace_head;
+	if (trace_lost != 0 && ((head + 1) & (TRACE_SIZE - 1)) != trace_tail) {
+		trace_store(head, TRACE_LOST, trace_lost);
+		head = (head + 1) & (TRACE_SIZE - 1);
+		trace_lost = 0;
+	}
+	if (((head + 1) & (TRACE_SIZE - 1)) == trace_tail) {
+		if (trace_lost != 0xFFFF)
+			trace_lost++;
+	} else {
+		trace_store(head, event, time);
+		head = (head + 1) & (TRACE_SIZE - 1);
+	}
+	trace_head = head;
+	TRACE_USART.CTRLA = USART_DREINTLVL_LO_gc;
+	SREG = sreg;
+}
+
+/*
+ * Starts a frame with the records that are in the ring now. Returns 0
+ * when the ring is empty.
+ */
+static uint8_t trace_frame(void)
+{
+	uint8_t n = (trace_head - trace_tail) & (TRACE_SIZE - 1);
+
+	if (n == 0)
+		return 0;
+	if (n > TRACE_FRAME)
+		n = TRACE_FRAME;
+	trace_header[0] = TRACE_SYNC;
+	trace_header[1] = n;
+	trace_sent = 0;
+	trace_byte = 0;
+	trace_left = n;
+	return 1;
+}
+
+/*
+ * Sends the next byte. The records are sent straight from the ring and
+ * freed one by one. The interrupt is low level, so it never delays the
+ * traced interrupts; at TRACE_BAUD a record takes 30 us.
+ */
+ISR(TRACE_DRE_vect)
+{
+	uint8_t sreg;
+
+	if (trace_sent == sizeof(trace_header) && trace_left == 0) {
+		sreg = SREG;
+		cli();										// no event between the check and the disable
+		if (!trace_frame())
+			TRACE_USART.CTRLA = USART_DREINTLVL_OFF_gc;	// until the next event
+		SREG = sreg;
+		if (trace_left == 0)
+			return;
+	}
+	if (trace_sent < sizeof(trace_header)) {
+		TRACE_USART.DATA = trace_header[trace_sent++];
+		return;
+	}
+	TRACE_USART.DATA = trace_ring[trace_tail][trace_byte];
+	if (++trace_byte == TRACE_RECORD) {
+		trace_byte = 0;
+		trace_tail = (trace_tail + 1) & (TRACE_SIZE - 1);
+		trace_left--;
+	}
+}
+
+#endif
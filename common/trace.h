@@ -0,0 +1,68 @@
+/*
+ * trace.h
+ *
+ * Begin and end events of the hot paths with a timestamp of a free
+ * running timer, kept in a ring buffer in SRAM. The data register empty
+ * interrupt of the USART sends them, host/tracedecode prints their
+ * latencies.
+ * With TRACE 0 the macros are empty and nothing of this is built.
+ *
+ * A record is the event byte and the 16 bit timestamp, low byte first.
+ * The timestamp counts F_CPU / TRACE_TC_DIV and wraps after 16 ms at
+ * 32 MHz, longer events can not be measured. On the line the records
+ * come in frames: TRACE_SYNC, the number of records and the records.
+ * Records that did not fit in the ring are replaced by one TRACE_LOST
+ * record, its timestamp field holds their number.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include "clock.h"
+
+#ifndef TRACE
+#define TRACE				0						// 1: record the events
+#endif
+
+#define TRACE_TC			TCD0					// free running timestamp
+#define TRACE_TC_CLKSEL		TC_CLKSEL_DIV8_gc
+#define TRACE_TC_DIV		8
+#define TRACE_USART			USARTC0					// TX on PC3
+#define TRACE_DRE_vect		USARTC0_DRE_vect
+#define TRACE_USART_PORT	PORTC
+#define TRACE_USART_TX_bm	PIN3_bm
+#define TRACE_BAUD			1000000UL
+#define TRACE_SIZE			64						// records in the ring buffer, power of 2
+#define TRACE_FRAME			16						// records per frame at most
+#define TRACE_SYNC			0xA5					// first byte of a frame
+
+#define TRACE_BSEL			((F_CPU + 4 * TRACE_BAUD) / (8 * TRACE_BAUD) - 1)	// double speed
+
+#if TRACE_SIZE & (TRACE_SIZE - 1) || TRACE_SIZE > 256
+#error "TRACE_SIZE must be a power of 2 up to 256"
+#endif
+
+#define TRACE_END_bm		0x80					// event ends, else it begins
+
+#define TRACE_LOST			0						// records were dropped here
+#define TRACE_LCD_BYTE		1						// LCD_WRITE_BYTE
+#define TRACE_LCD_CLEAR		2						// lcd_clear
+#define TRACE_LCD_HOME		3						// lcd_home
+#define TRACE_SPI			4						// spi_transfer
+#define TRACE_SPI_BLOCK		5						// spi_transfer_block
+#define TRACE_MATRIX_ROW	6						// row push of the matrix refresh
+#define TRACE_MATRIX_BLANK	7						// blanking of the row by the brightness
+
+#if TRACE==1
+#define TRACE_BEGIN(e)		trace_event(e)
+#define TRACE_END(e)		trace_event((e) | TRACE_END_bm)
+#else
+#define TRACE_BEGIN(e)
+#define TRACE_END(e)
+#endif
+
+void trace_init(void);
+void trace_event(uint8_t event);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,58 @@
+/*
+ * bench_sim.cpp
+ *
+ * Runs a benchmark image of bench/ on the simulator. The image is built
+ * with its main() renamed to bench_main(). This main() attaches the
+ * devices the image talks to, a 16x2 display with BENCH_LCD or the module
+ * chain of the matrix, and prints what the image sends on USARTC0. The
+ * run ends when the image sleeps with the interrupts disabled.
+ *
+ * The cycles of the simulator are those of the register accesses, the
+ * delays and the interrupt entries, see sim.h. Code between register
+ * accesses takes no time, so the results are the I/O bound part of the
+ * cycles of the part.
+ */
+
+#include <stdio.h>
+#include "sim.h"
+#ifdef BENCH_LCD
+#include "lcd.h"
+#include "hd44780.h"
+#else
+#include "matrix.h"
+#include "shiftmatrix.h"
+#endif
+
+int bench_main(void);
+
+class console : public sim_device {
+public:
+	void usart(uint8_t usart, uint8_t tx) override
+	{
+		if (usart == SIM_USARTC0 && tx != '\r')
+			putchar(tx);
+	}
+};
+
+int main(void)
+{
+	console con;
+#ifdef BENCH_LCD
+	hd44780::pins_t pins = {
+		sim_port_index(&LCD_DATA_PORT),
+		{ LCD_D0_bp, LCD_D1_bp, LCD_D2_bp, LCD_D3_bp, LCD_D4_bp, LCD_D5_bp, LCD_D6_bp, LCD_D7_bp },
+		LCD_4BIT_MODE,
+		sim_port_index(&LCD_RS_PORT), LCD_RS_bp,
+		sim_port_index(&LCD_RW_PORT), LCD_RW_bp,
+		sim_port_index(&LCD_E_PORT), LCD_E_bp,
+	};
+	hd44780 device(pins);
+#else
+	shiftmatrix device(SIM_SPIC, SIM_PORTC, PIN0_bp, MATRIX_MODULES);
+#endif
+
+	sim_reset();
+	sim_attach(&con);
+	sim_attach(&device);
+	return bench_main();
+}
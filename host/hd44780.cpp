@@ -0,0 +1,277 @@
+/*
+ * hd44780.cpp
+ *
+ * Simulated HD44780U text display, see hd44780.h.
+ */
+
+#include <string.h>
+#include "hd44780.h"
+
+#define HD44780_POWER_US	15000.0			// internal reset after power on
+#define HD44780_INIT1_US	4100.0			// after the first function set
+#define HD44780_INIT2_US	100.0			// after the second function set
+#define HD44780_EXEC_US		37.0			// most instructions and data writes
+#define HD44780_CLEAR_US	1520.0			// clear display and return home
+#define HD44780_PWEH_NS		230.0			// minimum width of the E pulse
+
+hd44780::hd44780(const pins_t &pins) : pins_(pins), readback_(1)
+{
+	memset(watch_, 0, sizeof(watch_));
+	watch_[pins_.rs_port] |= 1 << pins_.rs_bp;
+	watch_[pins_.rw_port] |= 1 << pins_.rw_bp;
+	for (uint8_t i = pins_.wiring4 ? 4 : 0; i < 8; i++)
+		watch_[pins_.data_port] |= 1 << pins_.d_bp[i];
+	power_on();
+}
+
+/*
+ * Resets the display like switching the supply on: 8 bit interface, one
+ * line, display off, DDRAM cleared and busy with the internal reset.
+ */
+void hd44780::power_on(void)
+{
+	for (uint8_t p = 0; p < SIM_PORTS; p++)
+		levels_[p] = sim_port_pins(p);
+	e_ = level(pins_.e_port, pins_.e_bp);
+	e_rise_ = 0;
+	nibble_ = 0;
+	high_ = 0;
+	read_ = 0;
+	init_ = 0;
+	memset(ddram_, ' ', sizeof(ddram_));
+	memset(cgram_, 0, sizeof(cgram_));
+	ac_ = 0;
+	cg_ = 0;
+	dl_ = 1;
+	n_ = 0;
+	id_ = 1;
+	s_ = 0;
+	display_ = 0;
+	shift_ = 0;
+	busy_until_ = 0;
+	busy_for(HD44780_POWER_US);
+	clear_stats();
+}
+
+void hd44780::readback(uint8_t on)
+{
+	readback_ = on;
+}
+
+uint8_t hd44780::busy(void) const
+{
+	return sim_now() < busy_until_;
+}
+
+void hd44780::clear_stats(void)
+{
+	memset(&stats_, 0, sizeof(stats_));
+}
+
+/*
+ * Returns the visible characters of the line that starts at DDRAM address
+ * start, with the display shift applied.
+ */
+std::string hd44780::line(uint8_t start, uint8_t length) const
+{
+	uint8_t size = n_ ? 40 : 80;
+	uint8_t base = n_ ? (start & 0x40) : 0;
+	uint8_t first = n_ ? (start & 0x3F) : start;
+	std::string s;
+
+	for (uint8_t x = 0; x < length; x++)
+		s += (char)ddram_[base + (first + x + shift_ + 2 * size) % size];
+	return s;
+}
+
+void hd44780::busy_for(double us)
+{
+	busy_until_ = sim_now() + sim_cycles(us);
+}
+
+/*
+ * Returns the byte on the data lines, D0..D3 are low in 4 bit wiring.
+ */
+uint8_t hd44780::bus(void) const
+{
+	uint8_t b = 0;
+
+	for (uint8_t i = pins_.wiring4 ? 4 : 0; i < 8; i++)
+		b |= level(pins_.data_port, pins_.d_bp[i]) << i;
+	return b;
+}
+
+void hd44780::pins(uint8_t port, uint8_t old, uint8_t now)
+{
+	uint8_t e;
+
+	levels_[port] = now;
+	if (e_ && ((old ^ now) & watch_[port]))
+		stats_.hold++;
+
+	e = level(pins_.e_port, pins_.e_bp);
+	if (e == e_)
+		return;
+	e_ = e;
+	if (e) {
+		e_rise_ = sim_now();
+		if (level(pins_.rw_port, pins_.rw_bp) && (dl_ || !nibble_))
+			read_ = level(pins_.rs_port, pins_.rs_bp) ? (cg_ ? cgram_[ac_ & 0x3F] : ddram_[ac_])
+			                                         : (busy() << 7) | ac_;
+	} else {
+		if (sim_us(sim_now() - e_rise_) * 1000.0 < HD44780_PWEH_NS)
+			stats_.pulse++;
+		falling_edge();
+	}
+}
+
+uint8_t hd44780::drive(uint8_t port, uint8_t *level_out)
+{
+	uint8_t mask = 0;
+	uint8_t b;
+
+	if (port != pins_.data_port)
+		return 0;
+	for (uint8_t i = pins_.wiring4 ? 4 : 0; i < 8; i++)
+		mask |= 1 << pins_.d_bp[i];
+	if (!readback_) {
+		*level_out = mask;
+		return mask;
+	}
+	if (!e_ || !level(pins_.rw_port, pins_.rw_bp))
+		return 0;
+
+	b = read_;
+	if (!dl_ && nibble_)
+		b <<= 4;							// low nibble on D7..D4
+	*level_out = 0;
+	for (uint8_t i = 0; i < 8; i++)
+		if (b & (1 << i))
+			*level_out |= 1 << pins_.d_bp[i];
+	return mask;
+}
+
+/*
+ * End of a transfer: the data lines are sampled, in 4 bit mode two
+ * transfers make one byte.
+ */
+void hd44780::falling_edge(void)
+{
+	uint8_t rs = level(pins_.rs_port, pins_.rs_bp);
+	uint8_t rw = level(pins_.rw_port, pins_.rw_bp);
+
+	if (!dl_) {
+		if (!nibble_) {
+			high_ = bus() & 0xF0;
+			nibble_ = 1;
+			return;
+		}
+		nibble_ = 0;
+	}
+	if (rw) {
+		stats_.reads++;
+		if (rs) {
+			if (busy())
+				stats_.busy++;
+			next_address();
+		}
+		return;
+	}
+	execute(rs, dl_ ? bus() : high_ | (bus() >> 4));
+}
+
+void hd44780::execute(uint8_t rs, uint8_t b)
+{
+	if (busy()) {
+		stats_.busy++;
+		return;
+	}
+	if (rs) {
+		write_data(b);
+		stats_.writes++;
+	} else {
+		instruction(b);
+		stats_.instructions++;
+	}
+}
+
+void hd44780::instruction(uint8_t b)
+{
+	double t = HD44780_EXEC_US;
+
+	if (b & 0x80) {							// set DDRAM address
+		ac_ = b & 0x7F;
+		cg_ = 0;
+	} else if (b & 0x40) {					// set CGRAM address
+		ac_ = b & 0x3F;
+		cg_ = 1;
+	} else if (b & 0x20) {					// function set
+		dl_ = (b >> 4) & 1;
+		n_ = (b >> 3) & 1;
+		nibble_ = 0;
+		if (init_ == 0)
+			t = HD44780_INIT1_US;
+		else if (init_ == 1)
+			t = HD44780_INIT2_US;
+		if (init_ < 2)
+			init_++;
+	} else if (b & 0x10) {					// cursor or display shift
+		int8_t d = (b & 0x04) ? -1 : 1;
+		if (b & 0x08) {
+			shift_ = (shift_ + d) % (n_ ? 40 : 80);
+		} else {
+			uint8_t id = id_;
+			id_ = (b & 0x04) != 0;
+			next_address();
+			id_ = id;
+		}
+	} else if (b & 0x08) {					// display on/off control
+		display_ = (b >> 2) & 1;
+	} else if (b & 0x04) {					// entry mode set
+		id_ = (b >> 1) & 1;
+		s_ = b & 1;
+	} else if (b & 0x02) {					// return home
+		ac_ = 0;
+		cg_ = 0;
+		shift_ = 0;
+		t = HD44780_CLEAR_US;
+	} else if (b & 0x01) {					// clear display
+		memset(ddram_, ' ', sizeof(ddram_));
+		ac_ = 0;
+		cg_ = 0;
+		id_ = 1;
+		shift_ = 0;
+		t = HD44780_CLEAR_US;
+	}
+	busy_for(t);
+}
+
+void hd44780::write_data(uint8_t b)
+{
+	if (cg_)
+		cgram_[ac_ & 0x3F] = b;
+	else
+		ddram_[ac_] = b;
+	next_address();
+	if (s_ && !cg_)
+		shift_ = (shift_ + (id_ ? 1 : -1)) % (n_ ? 40 : 80);
+	busy_for(HD44780_EXEC_US);
+}
+
+/*
+ * Moves the address counter in the direction of the entry mode. In two
+ * line mode DDRAM has two rows of 40, 0x00..0x27 and 0x40..0x67.
+ */
+void hd44780::next_address(void)
+{
+	if (cg_) {
+		ac_ = (ac_ + (id_ ? 1 : -1)) & 0x3F;
+	} else if (n_) {
+		if (id_)
+			ac_ = ac_ == 0x27 ? 0x40 : ac_ == 0x67 ? 0x00 : ac_ + 1;
+		else
+			ac_ = ac_ == 0x40 ? 0x27 : ac_ == 0x00 ? 0x67 : ac_ - 1;
+	} else {
+		ac_ = id_ ? (ac_ + 1) % 80 : (ac_ + 79) % 80;
+	}
+}
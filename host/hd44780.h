@@ -0,0 +1,100 @@
+/*
+ * hd44780.h
+ *
+ * Simulated HD44780U text display on the simulated ports, see sim.h.
+ *
+ * The display samples RS, R/W and the data lines at the falling edge of
+ * E, in 8 bit or 4 bit mode as set by the function set commands, and
+ * drives the data lines while E is high during a read. It executes the
+ * instructions with the times of the datasheet at 270 kHz and counts
+ * the protocol violations:
+ * - busy: an instruction or data write while the display is still busy,
+ *   it is ignored like on the real display
+ * - pulse: E high shorter than 230 ns
+ * - hold: RS, R/W or a data line changes while E is high
+ *
+ * readback(0) models a one way level shifter on the data lines: the
+ * display does not drive them and the pull-ups make them read high, so
+ * the busy flag never clears.
+ */
+
+#ifndef HD44780_H_
+#define HD44780_H_
+
+#include <stdint.h>
+#include <string>
+#include "sim.h"
+
+class hd44780 : public sim_device {
+public:
+	struct pins_t {
+		uint8_t data_port;					// SIM_PORTx of the data lines
+		uint8_t d_bp[8];					// bit position of D0..D7, D0..D3 unused in 4 bit wiring
+		uint8_t wiring4;					// 1 if only D4..D7 are connected
+		uint8_t rs_port, rs_bp;
+		uint8_t rw_port, rw_bp;
+		uint8_t e_port, e_bp;
+	};
+
+	struct stats_t {
+		uint32_t instructions;				// executed instructions
+		uint32_t writes;					// executed data writes
+		uint32_t reads;						// status and data reads
+		uint32_t busy;						// violations, see above
+		uint32_t pulse;
+		uint32_t hold;
+	};
+
+	explicit hd44780(const pins_t &pins);
+
+	void power_on(void);
+	void readback(uint8_t on);
+
+	uint8_t ddram(uint8_t addr) const { return ddram_[addr & 0x7F]; }
+	uint8_t cgram(uint8_t addr) const { return cgram_[addr & 0x3F]; }
+	uint8_t address(void) const { return ac_; }
+	uint8_t interface8(void) const { return dl_; }
+	uint8_t two_lines(void) const { return n_; }
+	uint8_t display_on(void) const { return display_; }
+	uint8_t increment(void) const { return id_; }
+	int8_t shift(void) const { return shift_; }
+	uint8_t busy(void) const;
+	uint64_t idle_at(void) const { return busy_until_; }
+	std::string line(uint8_t start, uint8_t length) const;
+	const stats_t &stats(void) const { return stats_; }
+	void clear_stats(void);
+
+	void pins(uint8_t port, uint8_t old, uint8_t now) override;
+	uint8_t drive(uint8_t port, uint8_t *level) override;
+
+private:
+	pins_t pins_;
+	uint8_t readback_;						// 0: the pins read high during a read
+	uint8_t levels_[SIM_PORTS];				// output levels of the ports
+	uint8_t watch_[SIM_PORTS];				// RS, R/W and data lines per port
+	uint8_t e_;
+	uint64_t e_rise_;
+	uint8_t nibble_;						// 1 after the high nibble in 4 bit mode
+	uint8_t high_;							// high nibble of the transfer
+	uint8_t read_;							// byte presented during a read
+	uint8_t init_;							// function sets seen since power on, max 2
+	uint8_t ddram_[128];
+	uint8_t cgram_[64];
+	uint8_t ac_;
+	uint8_t cg_;							// 1 if ac_ addresses CGRAM
+	uint8_t dl_, n_, id_, s_, display_;
+	int8_t shift_;							// display shift, positive is left
+	uint64_t busy_until_;
+	stats_t stats_;
+
+	uint8_t level(uint8_t port, uint8_t bp) const { return (levels_[port] >> bp) & 1; }
+	uint8_t bus(void) const;
+	void falling_edge(void);
+	void execute(uint8_t rs, uint8_t b);
+	void instruction(uint8_t b);
+	void write_data(uint8_t b);
+	void next_address(void);
+	void busy_for(double us);
+};
+
+#endif /* HD44780_H_ */
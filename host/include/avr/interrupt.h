@@ -0,0 +1,18 @@
+/*
+ * avr/interrupt.h
+ *
+ * Host replacement: sei() and cli() change the I flag of the simulated
+ * SREG, ISR() defines the handler that the simulator calls.
+ */
+
+#ifndef SIM_AVR_INTERRUPT_H_
+#define SIM_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define ISR(vector)	extern "C" void vector(void); extern "C" void vector(void)
+
+#define sei()		(SREG |= CPU_I_bm)
+#define cli()		(SREG &= (uint8_t)~CPU_I_bm)
+
+#endif /* SIM_AVR_INTERRUPT_H_ */
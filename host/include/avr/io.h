@@ -0,0 +1,351 @@
+/*
+ * avr/io.h
+ *
+ * Host replacement for the ATxmega128A4U register file. The registers are
+ * objects whose loads and stores go through the simulator in sim.cpp, so
+ * the driver sources compile unchanged as C++ and talk to simulated
+ * peripherals. Only the registers and bits used by the drivers are here;
+ * the layouts do not match the real part.
+ */
+
+#ifndef SIM_AVR_IO_H_
+#define SIM_AVR_IO_H_
+
+#include <stdint.h>
+
+#ifndef __cplusplus
+#error "the register model needs C++, compile the firmware sources with -x c++"
+#endif
+
+uint8_t  sim_read8(const volatile void *reg);
+void     sim_write8(volatile void *reg, uint8_t value, uint8_t rmw);
+uint16_t sim_read16(const volatile void *reg);
+void     sim_write16(volatile void *reg, uint16_t value);
+
+/*
+ * An 8 bit I/O register. A compound assignment is one read-modify-write,
+ * like sbi/cbi or lds/ori/sts on the real part.
+ */
+class register8_t {
+public:
+	uint8_t value;
+
+	operator uint8_t() const volatile { return sim_read8(this); }
+	uint8_t operator=(uint8_t v) volatile { sim_write8(this, v, 0); return v; }
+	uint8_t operator|=(uint8_t v) volatile { v |= sim_read8(this); sim_write8(this, v, 1); return v; }
+	uint8_t operator&=(uint8_t v) volatile { v &= sim_read8(this); sim_write8(this, v, 1); return v; }
+	uint8_t operator^=(uint8_t v) volatile { v ^= sim_read8(this); sim_write8(this, v, 1); return v; }
+	register8_t &operator=(const register8_t &) = delete;
+};
+
+/*
+ * A 16 bit I/O register, accessed as one unit (the TEMP register of the
+ * real part is not modelled).
+ */
+class register16_t {
+public:
+	uint16_t value;
+
+	operator uint16_t() const volatile { return sim_read16(this); }
+	uint16_t operator=(uint16_t v) volatile { sim_write16(this, v); return v; }
+	register16_t &operator=(const register16_t &) = delete;
+};
+
+typedef struct PORT_struct {
+	register8_t DIR, DIRSET, DIRCLR, DIRTGL;
+	register8_t OUT, OUTSET, OUTCLR, OUTTGL;
+	register8_t IN, INTCTRL, INT0MASK, INT1MASK, INTFLAGS, REMAP;
+	register8_t PIN0CTRL, PIN1CTRL, PIN2CTRL, PIN3CTRL, PIN4CTRL, PIN5CTRL, PIN6CTRL, PIN7CTRL;
+} PORT_t;
+
+typedef struct VPORT_struct {
+	register8_t DIR, OUT, IN, INTFLAGS;
+} VPORT_t;
+
+typedef struct PORTCFG_struct {
+	register8_t MPCMASK, VPCTRLA, VPCTRLB, CLKEVOUT;
+} PORTCFG_t;
+
+typedef struct SPI_struct {
+	register8_t CTRL, INTCTRL, STATUS, DATA;
+} SPI_t;
+
+typedef struct USART_struct {
+	register8_t DATA, reserved_1, STATUS, reserved_3, CTRLA, CTRLB, CTRLC, BAUDCTRLA, BAUDCTRLB;
+} USART_t;
+
+typedef struct TC0_struct {
+	register8_t CTRLA, CTRLB, CTRLC, CTRLD, CTRLE, INTCTRLA, INTCTRLB;
+	register8_t CTRLFCLR, CTRLFSET, CTRLGCLR, CTRLGSET, INTFLAGS, TEMP;
+	register16_t CNT, PER, CCA, CCB, CCC, CCD;
+	register16_t PERBUF, CCABUF, CCBBUF, CCCBUF, CCDBUF;
+} TC0_t;
+
+typedef TC0_t TC1_t;
+
+typedef struct EVSYS_struct {
+	register8_t CH0MUX, CH1MUX, CH2MUX, CH3MUX, CH4MUX, CH5MUX, CH6MUX, CH7MUX;
+	register8_t CH0CTRL, CH1CTRL, CH2CTRL, CH3CTRL, CH4CTRL, CH5CTRL, CH6CTRL, CH7CTRL;
+	register8_t STROBE, DATA;
+} EVSYS_t;
+
+typedef struct DMA_CH_struct {
+	register8_t CTRLA, CTRLB, ADDRCTRL, TRIGSRC;
+	register16_t TRFCNT;
+	register8_t REPCNT;
+	register8_t SRCADDR0, SRCADDR1, SRCADDR2;
+	register8_t DESTADDR0, DESTADDR1, DESTADDR2;
+} DMA_CH_t;
+
+typedef struct DMA_struct {
+	register8_t CTRL, INTFLAGS, STATUS;
+	DMA_CH_t CH0, CH1, CH2, CH3;
+} DMA_t;
+
+typedef struct PMIC_struct {
+	register8_t STATUS, INTPRI, CTRL;
+} PMIC_t;
+
+typedef struct OSC_struct {
+	register8_t CTRL, STATUS, XOSCCTRL, XOSCFAIL, RC32KCAL, PLLCTRL, DFLLCTRL;
+} OSC_t;
+
+typedef struct CLK_struct {
+	register8_t CTRL, PSCTRL, LOCK, RTCCTRL, USBCTRL;
+} CLK_t;
+
+typedef struct DFLL_struct {
+	register8_t CTRL, CALA, CALB, COMP0, COMP1, COMP2;
+} DFLL_t;
+
+extern PORT_t PORTA, PORTB, PORTC, PORTD, PORTE, PORTR;
+extern VPORT_t VPORT0, VPORT1, VPORT2, VPORT3;
+extern PORTCFG_t PORTCFG;
+extern SPI_t SPIC, SPID;
+extern USART_t USARTC0, USARTD0;
+extern TC0_t TCC0, TCD0, TCE0;
+extern TC1_t TCC1, TCD1;
+extern EVSYS_t EVSYS;
+extern DMA_t DMA;
+extern PMIC_t PMIC;
+extern OSC_t OSC;
+extern CLK_t CLK;
+extern DFLL_t DFLLRC32M, DFLLRC2M;
+extern register8_t sim_sreg, sim_ccp;
+
+#define SREG	sim_sreg
+#define CCP		sim_ccp
+
+#define CPU_I_bm	0x80
+#define CCP_IOREG_gc	0xD8
+
+#define PIN0_bp	0
+#define PIN1_bp	1
+#define PIN2_bp	2
+#define PIN3_bp	3
+#define PIN4_bp	4
+#define PIN5_bp	5
+#define PIN6_bp	6
+#define PIN7_bp	7
+#define PIN0_bm	0x01
+#define PIN1_bm	0x02
+#define PIN2_bm	0x04
+#define PIN3_bm	0x08
+#define PIN4_bm	0x10
+#define PIN5_bm	0x20
+#define PIN6_bm	0x40
+#define PIN7_bm	0x80
+
+#define PORT_ISC_BOTHEDGES_gc	0x00
+#define PORT_ISC_FALLING_gc		0x02
+#define PORT_OPC_PULLUP_gc		0x18
+#define PORT_INT0LVL_OFF_gc		0x00
+#define PORT_INT0LVL_LO_gc		0x01
+#define PORT_INT0LVL_MED_gc		0x02
+#define PORT_INT0LVL_HI_gc		0x03
+#define PORT_INT0IF_bm			0x01
+
+#define PORTCFG_VP0MAP_gm			0x0F
+#define PORTCFG_VP1MAP_gm			0xF0
+#define PORTCFG_VP2MAP_gm			0x0F
+#define PORTCFG_VP3MAP_gm			0xF0
+#define PORTCFG_VP0MAP_PORTA_gc		0x00
+#define PORTCFG_VP0MAP_PORTB_gc		0x01
+#define PORTCFG_VP0MAP_PORTC_gc		0x02
+#define PORTCFG_VP0MAP_PORTD_gc		0x03
+#define PORTCFG_VP0MAP_PORTE_gc		0x04
+#define PORTCFG_VP1MAP_PORTA_gc		0x00
+#define PORTCFG_VP1MAP_PORTB_gc		0x10
+#define PORTCFG_VP1MAP_PORTC_gc		0x20
+#define PORTCFG_VP1MAP_PORTD_gc		0x30
+#define PORTCFG_VP1MAP_PORTE_gc		0x40
+#define PORTCFG_VP2MAP_PORTA_gc		0x00
+#define PORTCFG_VP2MAP_PORTB_gc		0x01
+#define PORTCFG_VP2MAP_PORTC_gc		0x02
+#define PORTCFG_VP2MAP_PORTD_gc		0x03
+#define PORTCFG_VP2MAP_PORTE_gc		0x04
+#define PORTCFG_VP3MAP_PORTA_gc		0x00
+#define PORTCFG_VP3MAP_PORTB_gc		0x10
+#define PORTCFG_VP3MAP_PORTC_gc		0x20
+#define PORTCFG_VP3MAP_PORTD_gc		0x30
+#define PORTCFG_VP3MAP_PORTE_gc		0x40
+
+#define SPI_CLK2X_bm			0x80
+#define SPI_ENABLE_bm			0x40
+#define SPI_DORD_bm				0x20
+#define SPI_MASTER_bm			0x10
+#define SPI_MODE_gm				0x0C
+#define SPI_MODE_0_gc			0x00
+#define SPI_PRESCALER_gm		0x03
+#define SPI_PRESCALER_DIV4_gc	0x00
+#define SPI_PRESCALER_DIV16_gc	0x01
+#define SPI_PRESCALER_DIV64_gc	0x02
+#define SPI_PRESCALER_DIV128_gc	0x03
+#define SPI_INTLVL_gm			0x03
+#define SPI_INTLVL_OFF_gc		0x00
+#define SPI_INTLVL_LO_gc		0x01
+#define SPI_INTLVL_MED_gc		0x02
+#define SPI_INTLVL_HI_gc		0x03
+#define SPI_IF_bm				0x80
+#define SPI_WRCOL_bm			0x40
+
+#define USART_RXCIF_bm			0x80
+#define USART_TXCIF_bm			0x40
+#define USART_DREIF_bm			0x20
+#define USART_RXCINTLVL_gm		0x30
+#define USART_RXCINTLVL_OFF_gc	0x00
+#define USART_RXCINTLVL_LO_gc	0x10
+#define USART_TXCINTLVL_gm		0x0C
+#define USART_DREINTLVL_gm		0x03
+#define USART_DREINTLVL_OFF_gc	0x00
+#define USART_DREINTLVL_LO_gc	0x01
+#define USART_DREINTLVL_MED_gc	0x02
+#define USART_DREINTLVL_HI_gc	0x03
+#define USART_RXEN_bm			0x10
+#define USART_TXEN_bm			0x08
+#define USART_CLK2X_bm			0x04
+#define USART_CHSIZE_8BIT_gc	0x03
+
+#define TC_CLKSEL_gm			0x0F
+#define TC_CLKSEL_OFF_gc		0x00
+#define TC_CLKSEL_DIV1_gc		0x01
+#define TC_CLKSEL_DIV2_gc		0x02
+#define TC_CLKSEL_DIV4_gc		0x03
+#define TC_CLKSEL_DIV8_gc		0x04
+#define TC_CLKSEL_DIV64_gc		0x05
+#define TC_CLKSEL_DIV256_gc		0x06
+#define TC_CLKSEL_DIV1024_gc	0x07
+#define TC_CLKSEL_EVCH0_gc		0x08
+#define TC_CLKSEL_EVCH1_gc		0x09
+#define TC_CLKSEL_EVCH2_gc		0x0A
+#define TC_CLKSEL_EVCH3_gc		0x0B
+#define TC_CLKSEL_EVCH4_gc		0x0C
+#define TC_CLKSEL_EVCH5_gc		0x0D
+#define TC_CLKSEL_EVCH6_gc		0x0E
+#define TC_CLKSEL_EVCH7_gc		0x0F
+#define TC_WGMODE_gm			0x07
+#define TC_WGMODE_NORMAL_gc		0x00
+#define TC_OVFINTLVL_gm			0x03
+#define TC_OVFINTLVL_OFF_gc		0x00
+#define TC_OVFINTLVL_LO_gc		0x01
+#define TC_OVFINTLVL_MED_gc		0x02
+#define TC_OVFINTLVL_HI_gc		0x03
+#define TC_CCAINTLVL_gm			0x03
+#define TC_CCAINTLVL_OFF_gc		0x00
+#define TC_CCAINTLVL_LO_gc		0x01
+#define TC_CCAINTLVL_MED_gc		0x02
+#define TC_CCAINTLVL_HI_gc		0x03
+#define TC_CMD_gm				0x0C
+#define TC_CMD_UPDATE_gc		0x04
+#define TC_CMD_RESTART_gc		0x08
+#define TC0_CMD_gm				TC_CMD_gm
+#define TC1_CMD_gm				TC_CMD_gm
+#define TC0_PERBV_bm			0x01
+#define TC0_CCABV_bm			0x02
+#define TC0_OVFIF_bm			0x01
+#define TC0_CCAIF_bm			0x10
+#define TC1_PERBV_bm			0x01
+#define TC1_CCABV_bm			0x02
+#define TC1_OVFIF_bm			0x01
+#define TC1_CCAIF_bm			0x10
+
+#define EVSYS_CHMUX_OFF_gc			0x00
+#define EVSYS_CHMUX_TCC0_OVF_gc		0xC0
+#define EVSYS_CHMUX_TCC1_OVF_gc		0xC8
+#define EVSYS_CHMUX_TCD0_OVF_gc		0xD0
+#define EVSYS_CHMUX_TCD1_OVF_gc		0xD8
+#define EVSYS_CHMUX_TCE0_OVF_gc		0xE0
+
+#define DMA_ENABLE_bm				0x80
+#define DMA_PRIMODE_gm				0x03
+#define DMA_PRIMODE_RR0123_gc		0x00
+#define DMA_PRIMODE_CH0123_gc		0x03
+#define DMA_CH_ENABLE_bm			0x80
+#define DMA_CH_SINGLE_bm			0x04
+#define DMA_CH_BURSTLEN_gm			0x03
+#define DMA_CH_BURSTLEN_1BYTE_gc	0x00
+#define DMA_CH_ERRIF_bm				0x20
+#define DMA_CH_TRNIF_bm				0x10
+#define DMA_CH_TRNINTLVL_gm			0x03
+#define DMA_CH_TRNINTLVL_OFF_gc		0x00
+#define DMA_CH_TRNINTLVL_LO_gc		0x01
+#define DMA_CH_TRNINTLVL_MED_gc		0x02
+#define DMA_CH_TRNINTLVL_HI_gc		0x03
+#define DMA_CH_SRCRELOAD_gm			0xC0
+#define DMA_CH_SRCRELOAD_NONE_gc	0x00
+#define DMA_CH_SRCDIR_gm			0x30
+#define DMA_CH_SRCDIR_FIXED_gc		0x00
+#define DMA_CH_SRCDIR_INC_gc		0x10
+#define DMA_CH_DESTRELOAD_gm		0x0C
+#define DMA_CH_DESTRELOAD_NONE_gc	0x00
+#define DMA_CH_DESTDIR_gm			0x03
+#define DMA_CH_DESTDIR_FIXED_gc		0x00
+#define DMA_CH_DESTDIR_INC_gc		0x01
+#define DMA_CH_TRIGSRC_SPIC_gc		0x4A
+#define DMA_CH_TRIGSRC_SPID_gc		0x6A
+
+#define PMIC_LOLVLEN_bm			0x01
+#define PMIC_MEDLVLEN_bm		0x02
+#define PMIC_HILVLEN_bm			0x04
+
+#define OSC_RC2MEN_bm			0x01
+#define OSC_RC32MEN_bm			0x02
+#define OSC_RC32KEN_bm			0x04
+#define OSC_RC32MRDY_bm			0x02
+#define OSC_RC32KRDY_bm			0x04
+#define OSC_RC32MCREF_gm		0x06
+#define OSC_RC32MCREF_RC32K_gc	0x00
+#define CLK_SCLKSEL_gm			0x07
+#define CLK_SCLKSEL_RC32M_gc	0x01
+#define DFLL_ENABLE_bm			0x01
+
+/*
+ * Interrupt vectors. ISR() defines a function with the sim_ name, the
+ * simulator calls it when the flag, the level and the global interrupt
+ * flag allow it.
+ */
+#define DMA_CH0_vect		sim_DMA_CH0_vect
+#define DMA_CH1_vect		sim_DMA_CH1_vect
+#define DMA_CH2_vect		sim_DMA_CH2_vect
+#define DMA_CH3_vect		sim_DMA_CH3_vect
+#define PORTC_INT0_vect		sim_PORTC_INT0_vect
+#define PORTD_INT0_vect		sim_PORTD_INT0_vect
+#define PORTE_INT0_vect		sim_PORTE_INT0_vect
+#define TCC0_OVF_vect		sim_TCC0_OVF_vect
+#define TCC0_CCA_vect		sim_TCC0_CCA_vect
+#define TCC1_OVF_vect		sim_TCC1_OVF_vect
+#define TCC1_CCA_vect		sim_TCC1_CCA_vect
+#define SPIC_INT_vect		sim_SPIC_INT_vect
+#define USARTC0_RXC_vect	sim_USARTC0_RXC_vect
+#define USARTC0_DRE_vect	sim_USARTC0_DRE_vect
+#define TCD0_OVF_vect		sim_TCD0_OVF_vect
+#define TCD0_CCA_vect		sim_TCD0_CCA_vect
+#define TCD1_OVF_vect		sim_TCD1_OVF_vect
+#define TCD1_CCA_vect		sim_TCD1_CCA_vect
+#define SPID_INT_vect		sim_SPID_INT_vect
+#define USARTD0_RXC_vect	sim_USARTD0_RXC_vect
+#define USARTD0_DRE_vect	sim_USARTD0_DRE_vect
+#define TCE0_OVF_vect		sim_TCE0_OVF_vect
+#define TCE0_CCA_vect		sim_TCE0_CCA_vect
+
+#endif /* SIM_AVR_IO_H_ */
@@ -0,0 +1,22 @@
+/*
+ * avr/pgmspace.h
+ *
+ * Host replacement: flash and RAM share one address space.
+ */
+
+#ifndef SIM_AVR_PGMSPACE_H_
+#define SIM_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)				(s)
+#define pgm_read_byte(p)	(*(const uint8_t *)(p))
+#define pgm_read_word(p)	(*(const uint16_t *)(p))
+#define pgm_read_ptr(p)		(*(const void * const *)(p))
+#define memcpy_P			memcpy
+#define strlen_P			strlen
+#define strcmp_P			strcmp
+
+#endif /* SIM_AVR_PGMSPACE_H_ */
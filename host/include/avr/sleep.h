@@ -0,0 +1,26 @@
+/*
+ * avr/sleep.h
+ *
+ * Host replacement: sleep_cpu() lets the simulator run until an interrupt
+ * has run. With the interrupts disabled it ends the program, as nothing
+ * could wake the part.
+ */
+
+#ifndef SIM_AVR_SLEEP_H_
+#define SIM_AVR_SLEEP_H_
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE			0x00
+#define SLEEP_MODE_PWR_DOWN		0x04
+#define SLEEP_MODE_PWR_SAVE		0x06
+#define SLEEP_MODE_STANDBY		0x0C
+
+void sim_sleep(void);
+
+#define set_sleep_mode(mode)	((void)(mode))
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()				sim_sleep()
+
+#endif /* SIM_AVR_SLEEP_H_ */
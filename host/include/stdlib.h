@@ -0,0 +1,38 @@
+/*
+ * stdlib.h
+ *
+ * Host addition to the C library: the conversions of avr-libc that the
+ * firmware uses.
+ */
+
+#ifndef SIM_STDLIB_H_
+#define SIM_STDLIB_H_
+
+#include_next <stdlib.h>
+
+static inline char *ultoa(unsigned long value, char *s, int radix)
+{
+	char *p = s, *q;
+
+	do {
+		unsigned digit = value % radix;
+
+		*p++ = digit < 10 ? '0' + digit : 'a' + digit - 10;
+		value /= radix;
+	} while (value);
+	*p = '\0';
+	for (q = s, p--; q < p; q++, p--) {
+		char c = *q;
+
+		*q = *p;
+		*p = c;
+	}
+	return s;
+}
+
+static inline char *utoa(unsigned value, char *s, int radix)
+{
+	return ultoa(value, s, radix);
+}
+
+#endif /* SIM_STDLIB_H_ */
@@ -0,0 +1,38 @@
+/*
+ * util/atomic.h
+ *
+ * Host replacement for ATOMIC_BLOCK with the same semantics as avr-libc:
+ * the interrupts are disabled in the block and SREG is restored or the
+ * interrupts are enabled when the block is left.
+ */
+
+#ifndef SIM_UTIL_ATOMIC_H_
+#define SIM_UTIL_ATOMIC_H_
+
+#include <avr/interrupt.h>
+
+static inline uint8_t sim_atomic_enter(void)
+{
+	uint8_t sreg = SREG;
+
+	cli();
+	return sreg;
+}
+
+static inline void sim_atomic_restore(const uint8_t *sreg)
+{
+	SREG = *sreg;
+}
+
+static inline void sim_atomic_forceon(const uint8_t *sreg)
+{
+	(void)sreg;
+	sei();
+}
+
+#define ATOMIC_RESTORESTATE	uint8_t sim_sreg_save __attribute__((__cleanup__(sim_atomic_restore))) = sim_atomic_enter()
+#define ATOMIC_FORCEON		uint8_t sim_sreg_save __attribute__((__cleanup__(sim_atomic_forceon))) = sim_atomic_enter()
+
+#define ATOMIC_BLOCK(type)	for (type, sim_once = 1; sim_once; sim_once = 0)
+
+#endif /* SIM_UTIL_ATOMIC_H_ */
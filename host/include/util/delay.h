@@ -0,0 +1,28 @@
+/*
+ * util/delay.h
+ *
+ * Host replacement: a delay advances the simulated clock by the same
+ * number of cycles as the busy loop on the real part, so timers and
+ * interrupts keep running during the delay.
+ */
+
+#ifndef SIM_UTIL_DELAY_H_
+#define SIM_UTIL_DELAY_H_
+
+#ifndef F_CPU
+#error "F_CPU must be defined before <util/delay.h>"
+#endif
+
+void sim_delay_cycles(double cycles);
+
+static inline void _delay_us(double us)
+{
+	sim_delay_cycles(us * (F_CPU / 1e6));
+}
+
+static inline void _delay_ms(double ms)
+{
+	sim_delay_cycles(ms * (F_CPU / 1e3));
+}
+
+#endif /* SIM_UTIL_DELAY_H_ */
@@ -0,0 +1,650 @@
+/*
+ * lcd_test.cpp
+ *
+ * Runs lcd.c against the simulated HD44780 in the mode given by the
+ * LCD_... macros on the command line, checks the display contents and
+ * the protocol, and prints the bus time of the common operations. Two
+ * more displays, 20x2 and 20x4, share the bus with their own E line.
+ *
+ * usage: lcd_test [-t trace.txt] [-r records.bin]
+ *
+ * -t writes the pin and bus trace of the simulator, -r the bytes that
+ * trace.c sent on its USART when built with TRACE 1.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "lcd.h"
+#include "sim.h"
+#include "hd44780.h"
+#include "trace.h"
+#include "usartlog.h"
+
+#define PANELS		3
+
+static lcd_t panels[PANELS];				// 16x2 on LCD_E, 20x2 on PD6, 20x4 on PD7
+static hd44780 *displays[PANELS];
+static lcd_t *lcd = &panels[0];
+static hd44780 *display;
+static int failures = 0;
+
+#define CHECK(c)	check((c), #c, __LINE__)
+
+static void check(bool ok, const char *what, int line)
+{
+	if (!ok) {
+		printf("FAIL line %d: %s\n", line, what);
+		failures++;
+	}
+}
+
+/*
+ * Waits until the driver has sent everything and the displays are idle.
+ */
+static void settle(void)
+{
+	for (uint8_t i = 0; i < PANELS; i++) {
+#if LCD_QUEUE==1
+		lcd_flush(&panels[i]);
+#endif
+		if (sim_now() < displays[i]->idle_at())
+			sim_run(displays[i]->idle_at() - sim_now());
+	}
+}
+
+static void puts_str(lcd_t *p, const char *s)
+{
+	char buf[64];
+
+	strncpy(buf, s, sizeof(buf) - 1);
+	buf[sizeof(buf) - 1] = '\0';
+	lcd_puts(p, buf);
+}
+
+static std::string panel_line(uint8_t i, uint8_t y)
+{
+	return displays[i]->line(LCD_START_LINE(y, panels[i].length), panels[i].length);
+}
+
+static std::string line(uint8_t y)
+{
+	return panel_line(0, y);
+}
+
+static void check_protocol(const char *where, hd44780 *d = display)
+{
+	const hd44780::stats_t &s = d->stats();
+
+	if (s.busy || s.pulse || s.hold) {
+		printf("FAIL %s: %u busy, %u pulse, %u hold violations\n", where,
+		       (unsigned)s.busy, (unsigned)s.pulse, (unsigned)s.hold);
+		failures++;
+	}
+}
+
+static void test_init(void)
+{
+	lcd_init(lcd, &LCD_E_PORT, LCD_E_bp, 2, 16);
+	sei();
+	settle();
+	check_protocol("lcd_init");
+	CHECK(display->interface8() == !LCD_4BIT_MODE);
+	CHECK(display->two_lines());
+	CHECK(display->display_on());
+	CHECK(display->increment());
+	CHECK(lcd_status(lcd) == 0);
+	CHECK(line(0) == std::string(16, ' '));
+}
+
+static void test_text(void)
+{
+	lcd_gotoxy(lcd, 0, 0);
+	puts_str(lcd, "Hello, world!");
+	lcd_gotoxy(lcd, 0, 1);
+	puts_str(lcd, "0123456789ABCDEF");
+	settle();
+	CHECK(line(0) == "Hello, world!   ");
+	CHECK(line(1) == "0123456789ABCDEF");
+
+	puts_str(lcd, "\fab\ncd");
+	settle();
+	CHECK(line(0) == "ab              ");
+	CHECK(line(1) == "cd              ");
+
+	lcd_cmd(lcd, LCD_MOVE_DISP_LEFT);
+	settle();
+	CHECK(display->shift() == 1);
+	CHECK(line(0) == "b               ");
+	lcd_cmd(lcd, LCD_MOVE_DISP_RIGHT);
+	settle();
+	CHECK(line(0) == "ab              ");
+
+	lcd_cmd(lcd, 1 << LCD_CGRAM_bp);
+	for (uint8_t i = 0; i < 8; i++)
+		lcd_data(lcd, 0x11 * i);
+	lcd_gotoxy(lcd, 0, 0);
+	settle();
+	CHECK(display->cgram(7) == 0x77);
+	CHECK(line(0) == "ab              ");
+	check_protocol("text");
+}
+
+static void test_framebuffer(void)
+{
+#if LCD_FRAMEBUFFER==1
+	char text[] = "Temp 21.5 C\nRH 40%";
+	const hd44780::stats_t &s = display->stats();
+	uint32_t instructions, writes;
+
+	lcd_fb_clear(lcd);
+	lcd_fb_puts(lcd, text);
+	lcd_fb_flush(lcd);
+	settle();
+	CHECK(line(0) == "Temp 21.5 C     ");
+	CHECK(line(1) == "RH 40%          ");
+
+	instructions = s.instructions;
+	writes = s.writes;
+	lcd_fb_gotoxy(lcd, 8, 0);
+	lcd_fb_putc(lcd, '7');
+	lcd_fb_flush(lcd);
+	settle();
+	CHECK(line(0) == "Temp 21.7 C     ");
+	CHECK(s.instructions - instructions == 1);	// one gotoxy
+	CHECK(s.writes - writes == 1);				// one character
+
+	lcd_fb_flush(lcd);
+	settle();
+	CHECK(s.writes - writes == 1);				// nothing changed
+
+	lcd_clear(lcd);								// cursor known at 0, 0
+	lcd_data(lcd, 'Z');							// moves the address counter
+	lcd_fb_clear(lcd);
+	lcd_fb_puts(lcd, "ABCDEFGHIJKLMNOP");
+	lcd_fb_flush(lcd);
+	settle();
+	CHECK(line(0) == "ABCDEFGHIJKLMNOP");
+
+	lcd_clear(lcd);
+	lcd_putc(lcd, 'Z');							// same through lcd_putc()
+	lcd_fb_clear(lcd);
+	lcd_fb_puts(lcd, "ABCDEFGHIJKLMNOP");
+	lcd_fb_flush(lcd);
+	settle();
+	CHECK(line(0) == "ABCDEFGHIJKLMNOP");
+	check_protocol("framebuffer");
+#endif
+}
+
+#if LCD_GLYPH_CACHE==1 && LCD_FRAMEBUFFER==1
+#define GLYPHS		10
+
+static lcd_glyph_t glyphs[GLYPHS];
+
+/*
+ * Checks that the character at x, y of the display shows glyph id.
+ */
+static bool shows(uint8_t x, uint8_t y, uint8_t id)
+{
+	uint8_t c = display->ddram(LCD_START_LINE(y, 16) + x);
+
+	if (c >= LCD_GLYPH_SLOTS)
+		return false;
+	for (uint8_t r = 0; r < LCD_GLYPH_ROWS; r++)
+		if (display->cgram(c * LCD_GLYPH_ROWS + r) != glyphs[id][r])
+			return false;
+	return true;
+}
+#endif
+
+/*
+ * Eight glyphs fill the CGRAM, drawing them again uploads nothing. Two
+ * new glyphs take the slots of glyphs that are no longer on the screen,
+ * with all slots on the screen lcd_glyph() gives LCD_GLYPH_FULL and the
+ * screen does not change.
+ */
+static void test_glyphs(void)
+{
+#if LCD_GLYPH_CACHE==1 && LCD_FRAMEBUFFER==1
+	const hd44780::stats_t &s = display->stats();
+	uint32_t writes;
+
+	for (uint8_t id = 0; id < GLYPHS; id++)
+		for (uint8_t r = 0; r < LCD_GLYPH_ROWS; r++)
+			glyphs[id][r] = (id * 3 + r) & 0x1F;
+	lcd_glyph_library(lcd, glyphs);
+
+	lcd_fb_clear(lcd);
+	lcd_fb_puts(lcd, (char *)"glyphs");
+	lcd_fb_gotoxy(lcd, 0, 1);
+	for (uint8_t id = 0; id < 8; id++)
+		lcd_fb_glyph(lcd, id);
+	lcd_fb_flush(lcd);
+	settle();
+	for (uint8_t id = 0; id < 8; id++)
+		CHECK(shows(id, 1, id));
+
+	writes = s.writes;
+	lcd_fb_gotoxy(lcd, 0, 1);
+	for (uint8_t id = 0; id < 8; id++)
+		lcd_fb_glyph(lcd, id);
+	lcd_fb_flush(lcd);
+	settle();
+	CHECK(s.writes == writes);					// all hits, nothing changed
+
+	lcd_fb_gotoxy(lcd, 0, 1);
+	lcd_fb_glyph(lcd, 8);						// replaces glyph 0
+	lcd_fb_glyph(lcd, 9);						// replaces glyph 1
+	lcd_fb_flush(lcd);
+	settle();
+	CHECK(s.writes - writes == 2 * LCD_GLYPH_ROWS);	// same slots, so the same characters
+	CHECK(shows(0, 1, 8));
+	CHECK(shows(1, 1, 9));
+	for (uint8_t id = 2; id < 8; id++)
+		CHECK(shows(id, 1, id));
+
+	lcd_fb_gotoxy(lcd, 8, 1);
+	lcd_fb_glyph(lcd, 0);						// all 8 slots are on the screen
+	CHECK(lcd->fb[1][8] == LCD_GLYPH_FULL);
+	lcd_fb_flush(lcd);
+	settle();
+	CHECK(shows(0, 1, 8));
+	for (uint8_t id = 2; id < 8; id++)
+		CHECK(shows(id, 1, id));
+	CHECK(line(0) == "glyphs          ");
+	check_protocol("glyphs");
+#endif
+}
+
+#if LCD_TEMPLATE==1
+enum { FIELD_TEMP, FIELD_CODE, FIELD_NAME, FIELD_SMALL };
+
+static const char tpl_layout[] PROGMEM = "Temp      C\nName";
+static const lcd_field_t tpl_fields[] PROGMEM = {
+	{ 5, 0, 5, 10 }, { 12, 0, 4, 16 }, { 5, 1, 8, LCD_FIELD_TEXT }, { 14, 1, 2, 10 },
+};
+static const lcd_template_t tpl PROGMEM = { tpl_layout, tpl_fields, 4 };
+#endif
+
+/*
+ * Draws the template of a screen once and rewrites its fields. With the
+ * framebuffer a field update only sends the characters that changed.
+ */
+static void test_template(void)
+{
+	lcd_clear(lcd);
+	lcd_puts_P(lcd, PSTR("from flash"));
+	settle();
+	CHECK(line(0) == "from flash      ");
+#if LCD_TEMPLATE==1
+	const hd44780::stats_t &s = display->stats();
+	uint32_t writes;
+
+	lcd_clear(lcd);
+	lcd_template(lcd, &tpl);
+	lcd_field_num(lcd, FIELD_TEMP, 215);
+	lcd_field_num(lcd, FIELD_CODE, 0x2A);
+	lcd_field_text(lcd, FIELD_NAME, "Wim");
+	lcd_field_num(lcd, FIELD_SMALL, -5);
+#if LCD_FRAMEBUFFER==1
+	lcd_fb_flush(lcd);
+#endif
+	settle();
+	CHECK(line(0) == "Temp   215C 002a");
+	CHECK(line(1) == "Name Wim      -5");
+
+	writes = s.writes;
+	lcd_field_num(lcd, FIELD_TEMP, 216);
+	lcd_field_text(lcd, FIELD_NAME, "Matthijs!");
+	lcd_field_num(lcd, FIELD_SMALL, 100);
+#if LCD_FRAMEBUFFER==1
+	lcd_fb_flush(lcd);
+#endif
+	settle();
+	CHECK(line(0) == "Temp   216C 002a");
+	CHECK(line(1) == "Name Matthijs ##");
+#if LCD_FRAMEBUFFER==1
+	CHECK(s.writes - writes == 1 + 8 + 2);		// changed characters only
+#else
+	CHECK(s.writes - writes == 5 + 8 + 2);		// the fields
+#endif
+	lcd_field_num(lcd, FIELD_SMALL, -10);		// no room for the sign
+	lcd_field_num(lcd, FIELD_SMALL + 1, 1);	// no such field
+#if LCD_FRAMEBUFFER==1
+	lcd_fb_flush(lcd);
+#endif
+	settle();
+	CHECK(line(1) == "Name Matthijs ##");
+	check_protocol("template");
+#endif
+}
+
+static void test_exec_time(void)
+{
+	uint16_t t = lcd_exec_time_us(lcd, 0);
+
+#if LCD_BUSY_FLAG!=0
+	CHECK(t >= 37 && t <= 50);					// measured 37 us plus 25%
+#else
+	CHECK(t == TDELAY_us);
+#endif
+	(void)t;
+}
+
+/*
+ * Writes text to the displays on the other E lines, the 20x4 on all four
+ * lines, and times one line on one display and on all displays. With
+ * LCD_QUEUE the execution times of the displays overlap.
+ */
+static void test_panels(void)
+{
+	static const char *const text[4] = {
+		"line 1 of the 20x4", "line 2 of the 20x4", "line 3 of the 20x4", "line 4 of the 20x4",
+	};
+	std::string first = line(0);
+	uint64_t t0;
+	double one, all;
+
+	lcd_init(&panels[1], &LCD_COMM_PORT, PIN6_bp, 2, 20);
+	lcd_init(&panels[2], &LCD_COMM_PORT, PIN7_bp, 4, 20);
+	settle();
+	for (uint8_t y = 0; y < 4; y++) {
+		lcd_gotoxy(&panels[2], 0, y);
+		puts_str(&panels[2], text[y]);
+	}
+	puts_str(&panels[1], "\f20x2 first line\nand the second line");
+	settle();
+	for (uint8_t y = 0; y < 4; y++)
+		CHECK(panel_line(2, y) == std::string(text[y]) + "  ");
+	CHECK(panel_line(1, 0) == "20x2 first line     ");
+	CHECK(panel_line(1, 1) == "and the second line ");
+	CHECK(line(0) == first);					// not written through the other E lines
+
+#if LCD_FRAMEBUFFER==1
+	lcd_fb_clear(&panels[2]);
+	lcd_fb_gotoxy(&panels[2], 16, 3);
+	lcd_fb_puts(&panels[2], (char *)"last");
+	lcd_fb_invalidate(&panels[2]);
+	lcd_fb_flush(&panels[2]);
+	settle();
+	CHECK(panel_line(2, 3) == "                last");
+	CHECK(panel_line(2, 2) == std::string(20, ' '));
+#endif
+
+	t0 = sim_now();
+	lcd_gotoxy(&panels[2], 0, 0);
+	puts_str(&panels[2], "0123456789abcdef");
+	settle();
+	one = sim_us(sim_now() - t0);
+	t0 = sim_now();
+	for (uint8_t i = 0; i < PANELS; i++) {
+		lcd_gotoxy(&panels[i], 0, 0);
+		puts_str(&panels[i], "0123456789abcdef");
+	}
+	settle();
+	all = sim_us(sim_now() - t0);
+	for (uint8_t i = 0; i < PANELS; i++) {
+		CHECK(panel_line(i, 0).compare(0, 16, "0123456789abcdef") == 0);
+		check_protocol("panels", displays[i]);
+	}
+	printf("%-20s %10s %10.1f\n", "line on 1 display", "", one);
+	printf("%-20s %10s %10.1f\n", "line on 3 displays", "", all);
+#if LCD_QUEUE==1
+	CHECK(all < one * 1.5);
+#endif
+}
+
+/*
+ * lcd_init() clamps a geometry the addressing does not support, so no
+ * later lines - 1 wraps around.
+ */
+static void test_geometry(void)
+{
+	lcd_init(&panels[1], &LCD_COMM_PORT, PIN6_bp, 0, 0);
+	CHECK(panels[1].lines == 1 && panels[1].length == 1);
+	lcd_gotoxy(&panels[1], 0, 9);				// line 1 of 1
+	lcd_putc(&panels[1], 'x');
+	settle();
+	CHECK(panel_line(1, 0)[0] == 'x');
+	lcd_init(&panels[1], &LCD_COMM_PORT, PIN6_bp, 3, 40);
+	CHECK(panels[1].lines == 2 && panels[1].length == LCD_MAX_LENGTH);
+	lcd_init(&panels[1], &LCD_COMM_PORT, PIN6_bp, 8, 20);
+	CHECK(panels[1].lines == LCD_MAX_LINES);
+	lcd_init(&panels[1], &LCD_COMM_PORT, PIN6_bp, 2, 20);
+	settle();
+	check_protocol("geometry", displays[1]);
+}
+
+/*
+ * The marquee text that should be visible after steps steps, from offset
+ * characters right of the left most visible one.
+ */
+static std::string marquee_view(const char *text, unsigned steps, uint8_t length, uint8_t offset)
+{
+	std::string padded(text);
+	std::string view;
+
+	if (padded.size() < LCD_DDRAM_LENGTH)
+		padded.resize(LCD_DDRAM_LENGTH, ' ');
+	for (uint8_t x = 0; x < length; x++)
+		view += padded[(steps + offset + x) % padded.size()];
+	return view;
+}
+
+/*
+ * A short text costs one shift command per step. A long text also loads
+ * the columns out of view, about one character per step. On the 20x4 all
+ * columns are in view, line 3 shows the text that follows line 1.
+ */
+static void test_marquee(void)
+{
+#if LCD_MARQUEE==1
+	static const char text[] = "A marquee text that is longer than the 40 characters of a DDRAM line. ";
+	const hd44780::stats_t &s = display->stats();
+	uint32_t instructions, writes;
+	bool ok = true;
+
+	lcd_marquee(lcd, 0, "short text");
+	settle();
+	CHECK(line(0) == marquee_view("short text", 0, 16, 0));
+	instructions = s.instructions;
+	writes = s.writes;
+	for (unsigned i = 1; i <= 50; i++) {
+		lcd_marquee_step(lcd);
+		settle();
+		ok = ok && line(0) == marquee_view("short text", i, 16, 0);
+	}
+	CHECK(ok);
+	CHECK(s.instructions - instructions == 50);	// one shift per step
+	CHECK(s.writes == writes);
+
+	lcd_marquee(lcd, 1, text);
+	settle();
+	instructions = s.instructions;
+	writes = s.writes;
+	for (unsigned i = 1; i <= 200; i++) {
+		lcd_marquee_step(lcd);
+		settle();
+		ok = ok && line(1) == marquee_view(text, i, 16, 0);
+	}
+	CHECK(ok);
+	printf("%-20s %10.2f\n", "marquee bytes/step", (s.instructions - instructions + s.writes - writes) / 200.0);
+	CHECK(s.instructions - instructions + s.writes - writes < 200 * 2.2);
+	lcd_marquee_stop(lcd);
+	settle();
+	CHECK(display->shift() == 0);
+#if LCD_FRAMEBUFFER==1
+	lcd_fb_clear(lcd);							// a flush during the marquee
+	lcd_fb_puts(lcd, "framebuffer");
+	lcd_marquee(lcd, 0, text);
+	lcd_fb_flush(lcd);
+	for (unsigned i = 1; i <= 20; i++)
+		lcd_marquee_step(lcd);
+	lcd_marquee_stop(lcd);
+	lcd_fb_flush(lcd);
+	settle();
+	CHECK(line(0) == "framebuffer     ");
+#endif
+	check_protocol("marquee");
+
+	lcd_marquee(&panels[2], 0, text);
+	for (unsigned i = 1; i <= 100; i++) {
+		lcd_marquee_step(&panels[2]);
+		settle();
+		ok = ok && panel_line(2, 0) == marquee_view(text, i, 20, 0);
+		ok = ok && panel_line(2, 2) == marquee_view(text, i, 20, 20);
+	}
+	CHECK(ok);
+	lcd_marquee_stop(&panels[2]);
+	settle();
+	check_protocol("marquee 20x4", displays[2]);
+#endif
+}
+
+/*
+ * Without a working busy flag lcd_init() must report the fault and fall
+ * back to the fixed delays.
+ */
+static void test_busy_fault(void)
+{
+#if LCD_BUSY_FLAG!=0
+	display->power_on();
+	display->readback(0);
+	lcd_init(lcd, &LCD_E_PORT, LCD_E_bp, 2, 16);
+	settle();
+	CHECK(lcd_status(lcd) & LCD_FAULT_BUSY_bm);
+	lcd_gotoxy(lcd, 0, 1);
+	puts_str(lcd, "no busy flag");
+	settle();
+	CHECK(line(1) == "no busy flag    ");
+	check_protocol("busy fault");
+	display->readback(1);
+#endif
+}
+
+typedef struct {
+	const char *name;
+	void (*run)(void);
+} bench_t;
+
+static char bench_line[] = "0123456789abcdef";
+static char bench_screen[] = "Temp 21.5 C\nRH 40%";
+
+static void bench_putc(void) { lcd_putc(lcd, 'x'); }
+static void bench_puts(void) { lcd_puts(lcd, bench_line); }
+static void bench_gotoxy(void) { lcd_gotoxy(lcd, 3, 1); }
+static void bench_clear(void) { lcd_clear(lcd); }
+#if LCD_FRAMEBUFFER==1
+static void bench_fb_all(void) { lcd_fb_clear(lcd); lcd_fb_puts(lcd, bench_screen); lcd_fb_invalidate(lcd); lcd_fb_flush(lcd); }
+static void bench_fb_one(void) { lcd_fb_gotoxy(lcd, 8, 0); lcd_fb_putc(lcd, sim_now() & 1 ? '6' : '7'); lcd_fb_flush(lcd); }
+static void bench_fb_none(void) { lcd_fb_flush(lcd); }
+#endif
+
+static const bench_t benches[] = {
+	{ "lcd_putc", bench_putc },
+	{ "lcd_puts 16", bench_puts },
+	{ "lcd_gotoxy", bench_gotoxy },
+	{ "lcd_clear", bench_clear },
+#if LCD_FRAMEBUFFER==1
+	{ "lcd_fb_flush all", bench_fb_all },
+	{ "lcd_fb_flush one", bench_fb_one },
+	{ "lcd_fb_flush none", bench_fb_none },
+#endif
+};
+
+/*
+ * cpu: time until the call returns. done: time until the display has
+ * executed the last byte.
+ */
+static void bench(void)
+{
+	uint64_t t0, cpu;
+
+	printf("%-20s %10s %10s\n", "operation", "cpu us", "done us");
+	for (const bench_t &b : benches) {
+		settle();
+		t0 = sim_now();
+		b.run();
+		cpu = sim_now() - t0;
+		settle();
+		printf("%-20s %10.1f %10.1f\n", b.name, sim_us(cpu), sim_us(sim_now() - t0));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *trace = NULL;
+	const char *records = NULL;
+	hd44780::pins_t pins = {
+		sim_port_index(&LCD_DATA_PORT),
+		{ LCD_D0_bp, LCD_D1_bp, LCD_D2_bp, LCD_D3_bp, LCD_D4_bp, LCD_D5_bp, LCD_D6_bp, LCD_D7_bp },
+		LCD_4BIT_MODE,
+		sim_port_index(&LCD_RS_PORT), LCD_RS_bp,
+		sim_port_index(&LCD_RW_PORT), LCD_RW_bp,
+		sim_port_index(&LCD_E_PORT), LCD_E_bp,
+	};
+	hd44780::pins_t pins20x2 = pins, pins20x4 = pins;
+	uint64_t t0;
+
+	pins20x2.e_bp = PIN6_bp;
+	pins20x4.e_bp = PIN7_bp;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-t") == 0)
+			trace = argv[i + 1];
+		else if (strcmp(argv[i], "-r") == 0)
+			records = argv[i + 1];
+	}
+
+	sim_reset();
+	sim_trace(trace != NULL);
+	hd44780 hd(pins), hd20x2(pins20x2), hd20x4(pins20x4);
+	display = displays[0] = &hd;
+	displays[1] = &hd20x2;
+	displays[2] = &hd20x4;
+	for (hd44780 *d : displays)
+		sim_attach(d);
+	usartlog log(SIM_USARTC0);
+	sim_attach(&log);
+#if TRACE==1
+	trace_init();
+#endif
+
+	printf("lcd: LCD_4BIT_MODE %d LCD_BUSY_FLAG %d LCD_QUEUE %d LCD_FAST_IO %d TRACE %d\n",
+	       LCD_4BIT_MODE, LCD_BUSY_FLAG, LCD_QUEUE, LCD_FAST_IO, TRACE);
+	t0 = sim_now();
+	test_init();
+	printf("%-20s %10s %10.1f\n", "lcd_init", "", sim_us(sim_now() - t0));
+	test_text();
+	test_framebuffer();
+	test_glyphs();
+	test_exec_time();
+	test_panels();
+	test_geometry();
+	test_marquee();
+	test_template();
+	bench();
+	test_busy_fault();
+
+#if TRACE==1
+	sim_run(sim_cycles(TRACE_SIZE * 100.0));		// the ring drains at 30 us per record
+	CHECK(!log.bytes().empty());
+#endif
+	if (records && !log.save(records)) {
+		printf("FAIL can not write %s\n", records);
+		failures++;
+	}
+	if (trace) {
+		FILE *f = fopen(trace, "w");
+
+		if (f) {
+			sim_trace_dump(f);
+			fclose(f);
+		}
+	}
+	printf("%s\n\n", failures ? "FAILED" : "passed");
+	return failures != 0;
+}
@@ -0,0 +1,263 @@
+/*
+ * matrix_test.cpp
+ *
+ * Runs matrix.c and Spi.c of the LED matrix against the simulated module
+ * chain, checks the grey levels and the brightness by the on time of
+ * every pixel and prints the refresh load.
+ *
+ * usage: matrix_test [-t trace.txt] [-r records.bin]
+ *
+ * -t writes the pin and bus trace of the simulator, -r the bytes that
+ * trace.c sent on its USART when built with TRACE 1.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "matrix.h"
+#include "Spi.h"
+#include "sim.h"
+#include "shiftmatrix.h"
+#include "text.h"
+#include "font.h"
+#include "anim.h"
+#include "trace.h"
+#include "usartlog.h"
+
+static shiftmatrix *chain;
+static int failures = 0;
+
+#define CHECK(c)	check((c), #c, __LINE__)
+
+static void check(bool ok, const char *what, int line)
+{
+	if (!ok) {
+		printf("FAIL line %d: %s\n", line, what);
+		failures++;
+	}
+}
+
+/*
+ * Runs until frames more frames have started.
+ */
+static void run_frames(uint8_t frames)
+{
+	uint8_t start = matrix_frames();
+
+	while ((uint8_t)(matrix_frames() - start) < frames)
+		sim_run(100);
+}
+
+static void show(void)
+{
+	matrix_swap();
+	while (!matrix_ready())
+		sim_run(100);
+	run_frames(1);
+}
+
+static uint8_t level_at(uint8_t x, uint8_t y)
+{
+	return (x * 2 + y) % MATRIX_LEVELS;
+}
+
+/*
+ * Checks that every pixel is on for level / (MATRIX_LEVELS - 1) of its
+ * row time, scaled by brightness / 256.
+ */
+static void check_levels(double brightness, double tolerance)
+{
+	double row = chain->elapsed() / (double)MATRIX_ROWS;
+	double worst = 0;
+
+	for (uint8_t y = 0; y < MATRIX_ROWS; y++) {
+		for (uint8_t x = 0; x < MATRIX_WIDTH; x++) {
+			double want = brightness * level_at(x, y) / (MATRIX_LEVELS - 1);
+			double got = chain->on_time(x, y) / row;
+
+			worst = fmax(worst, fabs(got - want));
+		}
+	}
+	if (worst > tolerance) {
+		printf("FAIL levels at brightness %.2f: error %.4f\n", brightness, worst);
+		failures++;
+	}
+}
+
+/*
+ * A text appended in the middle of a character goes on with the next
+ * character of the longer text, as if that had been shown from the start.
+ */
+static void test_append(void)
+{
+	static const char shown[] = "AB";
+	static const char longer[] = "AB-CD";
+	text_t ref, text;
+	bool ok = true;
+	unsigned mid = font_width('A') + TEXT_SPACING + 1;	// in the B
+
+	text_start(&ref, longer);
+	text_start(&text, shown);
+	for (unsigned i = 0; i < 100; i++) {
+		if (i == mid)
+			text_append(&text, longer);
+		ok = ok && text_column(&text) == text_column(&ref);
+	}
+	CHECK(ok);
+}
+
+/*
+ * Grey level of pixel x, y of the back buffer.
+ */
+static uint8_t back_level(uint8_t x, uint8_t y)
+{
+	matrix_plane_t *planes = matrix_backbuffer();
+	uint8_t level = 0;
+
+	for (uint8_t b = 0; b < MATRIX_BITS; b++)
+		level |= (planes[b][y][x / 8] >> (7 - x % 8) & 1) << b;
+	return level;
+}
+
+/*
+ * The animations unpack to the frames of anim.txt, plain and XOR coded,
+ * and a looping one starts again with its first frame.
+ */
+static void test_anim(void)
+{
+	matrix_plane_t first[MATRIX_BITS];
+	anim_t anim;
+	unsigned frames = 0;
+
+	CHECK(anim_start(&anim, ANIM_HEART));
+	CHECK(anim_frame(&anim) == 40);
+	CHECK(back_level(3, 1) == MATRIX_LEVELS - 1 && back_level(2, 1) == 0);
+	memcpy(first, matrix_backbuffer(), sizeof(first));
+	CHECK(anim_frame(&anim) == 15);
+	CHECK(back_level(2, 5) == MATRIX_LEVELS - 1 && back_level(1, 5) == 0);
+	CHECK(anim_frame(&anim) == 40);
+	CHECK(memcmp(first, matrix_backbuffer(), sizeof(first)) == 0);
+
+	CHECK(anim_start(&anim, ANIM_FADE));
+	CHECK(anim_frame(&anim) == 8);
+	CHECK(back_level(0, 0) == 15 && back_level(1, 0) == 6 && back_level(7, 0) == 0);
+	memcpy(first, matrix_backbuffer(), sizeof(first));
+	for (unsigned i = 0; i < 3; i++)
+		anim_frame(&anim);
+	CHECK(back_level(0, 0) == 4 && back_level(7, 0) == 5);
+	CHECK(anim_frame(&anim) == 8);
+	CHECK(memcmp(first, matrix_backbuffer(), sizeof(first)) == 0);
+
+	CHECK(anim_start(&anim, ANIM_WIPE));
+	while (anim_frame(&anim))
+		frames++;
+	CHECK(frames == 8);
+	CHECK(back_level(0, 0) == MATRIX_LEVELS - 1 && back_level(7, 7) == MATRIX_LEVELS - 1);
+}
+
+int main(int argc, char **argv)
+{
+	const char *trace = NULL;
+	const char *records = NULL;
+	uint64_t t0, isr0, bytes;
+	double seconds;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-t") == 0)
+			trace = argv[i + 1];
+		else if (strcmp(argv[i], "-r") == 0)
+			records = argv[i + 1];
+	}
+
+	sim_reset();
+	shiftmatrix mx(SIM_SPIC, SIM_PORTC, PIN0_bp, MATRIX_MODULES);
+	chain = &mx;
+	sim_attach(&mx);
+	usartlog log(SIM_USARTC0);
+	sim_attach(&log);
+#if TRACE==1
+	trace_init();
+#endif
+
+	spi_init(F_CPU / 2);
+	matrix_init();
+	sei();
+
+	printf("matrix: MATRIX_MODULES %d MATRIX_BITS %d MATRIX_FRAME_HZ %d SPI_USE_DMA %d TRACE %d\n",
+	       MATRIX_MODULES, MATRIX_BITS, MATRIX_FRAME_HZ, SPI_USE_DMA, TRACE);
+
+	for (uint8_t y = 0; y < MATRIX_ROWS; y++)
+		for (uint8_t x = 0; x < MATRIX_WIDTH; x++)
+			matrix_set(x, y, level_at(x, y));
+	show();
+
+	sim_trace(1);
+	mx.clear();
+	t0 = sim_now();
+	isr0 = sim_isr_cycles();
+	run_frames(10);
+	check_levels(1.0, 0.01);
+	CHECK(mx.violations() == 0);
+	CHECK(mx.latches() == 10 * MATRIX_ROWS * MATRIX_BITS);
+	CHECK(!(SPIC.STATUS & SPI_WRCOL_bm));
+	CHECK(sim_spi_lost(SIM_SPIC) == 0);			// every byte read before the next one
+
+	seconds = sim_us(sim_now() - t0) / 1e6;
+	bytes = 0;
+	for (const sim_event_t &e : sim_events())
+		bytes += e.kind == SIM_SPI;
+	printf("%-20s %10.1f\n", "frames per second", 10 / seconds);
+	printf("%-20s %10.1f\n", "pushes per frame", mx.latches() / 10.0);
+	printf("%-20s %10.1f\n", "SPI bytes per frame", bytes / 10.0);
+	printf("%-20s %10.1f\n", "cycles per push", (sim_isr_cycles() - isr0) / (double)mx.latches());
+#if TRACE==0 && SPI_USE_DMA==1
+	CHECK((sim_isr_cycles() - isr0) <= (uint64_t)MATRIX_PUSH_ISR * mx.latches());
+#endif
+	printf("%-20s %10.2f\n", "refresh load %", 100.0 * (sim_isr_cycles() - isr0) / (sim_now() - t0));
+	CHECK(fabs(10 / seconds - MATRIX_FRAME_HZ) < MATRIX_FRAME_HZ * 0.01);
+	if (!trace)
+		sim_trace(0);
+
+	matrix_brightness(128);
+	run_frames(1);
+	mx.clear();
+	isr0 = sim_isr_cycles();
+	t0 = sim_now();
+	run_frames(10);
+	check_levels(0.5, 0.02);
+	CHECK(mx.violations() == 0);
+	printf("%-20s %10.2f\n", "load at half %", 100.0 * (sim_isr_cycles() - isr0) / (sim_now() - t0));
+
+	matrix_brightness(255);
+	matrix_scroll(0x01);						// bottom pixel in the right most column
+	show();
+	mx.clear();
+	run_frames(2);
+	CHECK(mx.on_time(MATRIX_WIDTH - 1, 0) > mx.elapsed() / MATRIX_ROWS * 0.99);
+	CHECK(mx.on_time(MATRIX_WIDTH - 1, 1) == 0);
+	CHECK(fabs(mx.on_time(MATRIX_WIDTH - 2, 0) / (mx.elapsed() / (double)MATRIX_ROWS) -
+	           level_at(MATRIX_WIDTH - 1, 0) / (double)(MATRIX_LEVELS - 1)) < 0.01);
+
+	test_append();
+	test_anim();
+
+#if TRACE==1
+	CHECK(!log.bytes().empty());
+#endif
+	if (records && !log.save(records)) {
+		printf("FAIL can not write %s\n", records);
+		failures++;
+	}
+	if (trace) {
+		FILE *f = fopen(trace, "w");
+
+		if (f) {
+			sim_trace_dump(f);
+			fclose(f);
+		}
+	}
+	printf("%s\n\n", failures ? "FAILED" : "passed");
+	return failures != 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * shiftmatrix.cpp
+ *
+ * Simulated chain of LED matrix modules, see shiftmatrix.h.
+ */
+
+#include <algorithm>
+#include "shiftmatrix.h"
+
+shiftmatrix::shiftmatrix(uint8_t spi, uint8_t latch_port, uint8_t latch_bp, uint8_t modules)
+	: spi_(spi), latch_port_(latch_port), latch_bm_(1 << latch_bp), modules_(modules),
+	  chain_(2 * modules), out_(2 * modules), on_(8 * 8 * modules),
+	  since_(sim_now()), last_(sim_now()), latches_(0), violations_(0)
+{
+}
+
+/*
+ * Returns 1 if pixel x, y is on now.
+ */
+uint8_t shiftmatrix::lit(uint8_t x, uint8_t y) const
+{
+	uint8_t m = x >> 3;
+
+	return (out_[2 * m + 1] & (0x80 >> y)) && (out_[2 * m] & (0x80 >> (x & 7)));
+}
+
+/*
+ * Returns the cycles pixel x, y was on since clear().
+ */
+uint64_t shiftmatrix::on_time(uint8_t x, uint8_t y)
+{
+	integrate();
+	return on_[y * width() + x];
+}
+
+/*
+ * Returns the cycles since clear().
+ */
+uint64_t shiftmatrix::elapsed(void)
+{
+	return sim_now() - since_;
+}
+
+void shiftmatrix::clear(void)
+{
+	integrate();
+	std::fill(on_.begin(), on_.end(), 0);
+	since_ = sim_now();
+	latches_ = 0;
+	violations_ = 0;
+}
+
+void shiftmatrix::integrate(void)
+{
+	uint64_t now = sim_now();
+
+	for (uint8_t y = 0; y < 8; y++)
+		for (uint8_t x = 0; x < width(); x++)
+			if (lit(x, y))
+				on_[y * width() + x] += now - last_;
+	last_ = now;
+}
+
+void shiftmatrix::pins(uint8_t port, uint8_t old, uint8_t now)
+{
+	if (port != latch_port_ || !(~old & now & latch_bm_))
+		return;
+	if (sim_spi_busy(spi_))
+		violations_++;
+	integrate();
+	out_ = chain_;
+	latches_++;
+}
+
+uint8_t shiftmatrix::spi(uint8_t spi, uint8_t mosi)
+{
+	uint8_t miso;
+
+	if (spi != spi_)
+		return 0xFF;
+	miso = chain_.back();
+	chain_.insert(chain_.begin(), mosi);
+	chain_.pop_back();
+	return miso;
+}
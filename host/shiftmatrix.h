@@ -0,0 +1,52 @@
+/*
+ * shiftmatrix.h
+ *
+ * Simulated chain of 8x8 LED matrix modules on an SPI master, see sim.h.
+ *
+ * Every module has two 8 bit shift registers, the row select and the row
+ * data, with module 0 nearest to MOSI. The bytes are shifted in on SPI
+ * and copied to the outputs at the rising edge of the latch pin. A pixel
+ * is on when its row select bit (0x80 >> row, row 0 is the bottom row)
+ * and its column bit (0x80 >> column) are both set. The time every pixel
+ * is on is integrated, so grey levels and brightness can be measured.
+ * A latch while a byte is still being shifted is counted as a violation.
+ */
+
+#ifndef SHIFTMATRIX_H_
+#define SHIFTMATRIX_H_
+
+#include <stdint.h>
+#include <vector>
+#include "sim.h"
+
+class shiftmatrix : public sim_device {
+public:
+	shiftmatrix(uint8_t spi, uint8_t latch_port, uint8_t latch_bp, uint8_t modules);
+
+	uint8_t width(void) const { return 8 * modules_; }
+	uint8_t lit(uint8_t x, uint8_t y) const;
+	uint64_t on_time(uint8_t x, uint8_t y);
+	uint64_t elapsed(void);
+	void clear(void);
+	uint32_t latches(void) const { return latches_; }
+	uint32_t violations(void) const { return violations_; }
+
+	void pins(uint8_t port, uint8_t old, uint8_t now) override;
+	uint8_t spi(uint8_t spi, uint8_t mosi) override;
+
+private:
+	uint8_t spi_;
+	uint8_t latch_port_, latch_bm_;
+	uint8_t modules_;
+	std::vector<uint8_t> chain_;			// shift registers, [0] is nearest to MOSI
+	std::vector<uint8_t> out_;				// latched outputs
+	std::vector<uint64_t> on_;				// on time per pixel, row major
+	uint64_t since_;						// start of the measurement
+	uint64_t last_;							// time of the last integration
+	uint32_t latches_;
+	uint32_t violations_;
+
+	void integrate(void);
+};
+
+#endif /* SHIFTMATRIX_H_ */
@@ -0,0 +1,911 @@
+/*
+ * sim.cpp
+ *
+ * Register model of the ATxmega128A4U, see sim.h.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "sim.h"
+
+#ifndef F_CPU
+#define F_CPU 32000000UL
+#endif
+
+PORT_t PORTA, PORTB, PORTC, PORTD, PORTE, PORTR;
+VPORT_t VPORT0, VPORT1, VPORT2, VPORT3;
+PORTCFG_t PORTCFG;
+SPI_t SPIC, SPID;
+USART_t USARTC0, USARTD0;
+TC0_t TCC0, TCD0, TCE0;
+TC1_t TCC1, TCD1;
+EVSYS_t EVSYS;
+DMA_t DMA;
+PMIC_t PMIC;
+OSC_t OSC;
+CLK_t CLK;
+DFLL_t DFLLRC32M, DFLLRC2M;
+register8_t sim_sreg, sim_ccp;
+
+#define SIM_VECTOR(name)	extern "C" void sim_##name##_vect(void) __attribute__((weak));
+SIM_VECTOR(TCC0_OVF) SIM_VECTOR(TCC0_CCA) SIM_VECTOR(TCC1_OVF) SIM_VECTOR(TCC1_CCA)
+SIM_VECTOR(SPIC_INT) SIM_VECTOR(TCE0_OVF) SIM_VECTOR(TCE0_CCA) SIM_VECTOR(TCD0_OVF)
+SIM_VECTOR(TCD0_CCA) SIM_VECTOR(TCD1_OVF) SIM_VECTOR(TCD1_CCA) SIM_VECTOR(SPID_INT)
+SIM_VECTOR(USARTC0_DRE) SIM_VECTOR(USARTD0_DRE) SIM_VECTOR(DMA_CH0) SIM_VECTOR(DMA_CH1)
+SIM_VECTOR(DMA_CH2) SIM_VECTOR(DMA_CH3)
+
+static PORT_t *const sim_ports[SIM_PORTS] = { &PORTA, &PORTB, &PORTC, &PORTD, &PORTE, &PORTR };
+static VPORT_t *const sim_vports[4] = { &VPORT0, &VPORT1, &VPORT2, &VPORT3 };
+static SPI_t *const sim_spis[SIM_SPIS] = { &SPIC, &SPID };
+static USART_t *const sim_usarts[SIM_USARTS] = { &USARTC0, &USARTD0 };
+static TC0_t *const sim_tcs[] = { &TCC0, &TCC1, &TCD0, &TCD1, &TCE0 };
+static const uint8_t sim_tc_ovf_mux[] = {
+	EVSYS_CHMUX_TCC0_OVF_gc, EVSYS_CHMUX_TCC1_OVF_gc, EVSYS_CHMUX_TCD0_OVF_gc,
+	EVSYS_CHMUX_TCD1_OVF_gc, EVSYS_CHMUX_TCE0_OVF_gc
+};
+static DMA_CH_t *const sim_dma_chs[] = { &DMA.CH0, &DMA.CH1, &DMA.CH2, &DMA.CH3 };
+static const uint8_t sim_spi_trigsrc[SIM_SPIS] = { DMA_CH_TRIGSRC_SPIC_gc, DMA_CH_TRIGSRC_SPID_gc };
+
+#define SIM_TCS		(sizeof(sim_tcs) / sizeof(sim_tcs[0]))
+#define SIM_NEVER	UINT64_MAX
+
+static uint64_t sim_time = 0;				// cycles since reset
+static uint64_t sim_isr_time = 0;			// cycles spent in interrupts
+static uint8_t sim_level = 0;				// level of the running interrupt, 0 is none
+static std::vector<sim_device *> sim_devices;
+static std::vector<sim_event_t> sim_trace_events;
+static uint8_t sim_tracing = 0;
+static uint8_t sim_port_out[SIM_PORTS];		// OUT & DIR as seen by the devices
+
+typedef struct {
+	uint8_t busy;							// a byte is being shifted
+	uint64_t done;							// time the byte is complete
+	uint8_t rx;								// byte shifted in
+	uint8_t unread;							// rx is complete and DATA was not read yet
+	uint32_t lost;							// bytes overwritten before DATA was read
+} sim_spi_t;
+
+static sim_spi_t sim_spi[SIM_SPIS];
+
+typedef struct {
+	uint8_t busy;							// a byte is in the shift register
+	uint64_t done;							// time its stop bit is complete
+	uint8_t full;							// a byte waits in DATA
+	uint8_t data;
+} sim_usart_t;
+
+static sim_usart_t sim_usart[SIM_USARTS];
+static uint16_t sim_tc_pre[SIM_TCS];		// prescaler count of each timer
+
+/*
+ * Interrupt sources in the order of their vector numbers, which is their
+ * priority within a level.
+ */
+typedef struct {
+	void (*isr)(void);
+	register8_t *intctrl;					// register with the level
+	uint8_t shift;							// position of the level in intctrl
+	register8_t *flags;						// register with the flag
+	uint8_t flag_bm;
+	uint8_t state;							// the flag is a state, the vector does not clear it
+} sim_source_t;
+
+static const sim_source_t sim_sources[] = {
+	{ sim_DMA_CH0_vect, &DMA.CH0.CTRLB, 0, &DMA.CH0.CTRLB, DMA_CH_TRNIF_bm, 1 },
+	{ sim_DMA_CH1_vect, &DMA.CH1.CTRLB, 0, &DMA.CH1.CTRLB, DMA_CH_TRNIF_bm, 1 },
+	{ sim_DMA_CH2_vect, &DMA.CH2.CTRLB, 0, &DMA.CH2.CTRLB, DMA_CH_TRNIF_bm, 1 },
+	{ sim_DMA_CH3_vect, &DMA.CH3.CTRLB, 0, &DMA.CH3.CTRLB, DMA_CH_TRNIF_bm, 1 },
+	{ sim_TCC0_OVF_vect, &TCC0.INTCTRLA, 0, &TCC0.INTFLAGS, TC0_OVFIF_bm, 0 },
+	{ sim_TCC0_CCA_vect, &TCC0.INTCTRLB, 0, &TCC0.INTFLAGS, TC0_CCAIF_bm, 0 },
+	{ sim_TCC1_OVF_vect, &TCC1.INTCTRLA, 0, &TCC1.INTFLAGS, TC1_OVFIF_bm, 0 },
+	{ sim_TCC1_CCA_vect, &TCC1.INTCTRLB, 0, &TCC1.INTFLAGS, TC1_CCAIF_bm, 0 },
+	{ sim_SPIC_INT_vect, &SPIC.INTCTRL,  0, &SPIC.STATUS,   SPI_IF_bm, 0 },
+	{ sim_USARTC0_DRE_vect, &USARTC0.CTRLA, 0, &USARTC0.STATUS, USART_DREIF_bm, 1 },
+	{ sim_TCE0_OVF_vect, &TCE0.INTCTRLA, 0, &TCE0.INTFLAGS, TC0_OVFIF_bm, 0 },
+	{ sim_TCE0_CCA_vect, &TCE0.INTCTRLB, 0, &TCE0.INTFLAGS, TC0_CCAIF_bm, 0 },
+	{ sim_TCD0_OVF_vect, &TCD0.INTCTRLA, 0, &TCD0.INTFLAGS, TC0_OVFIF_bm, 0 },
+	{ sim_TCD0_CCA_vect, &TCD0.INTCTRLB, 0, &TCD0.INTFLAGS, TC0_CCAIF_bm, 0 },
+	{ sim_TCD1_OVF_vect, &TCD1.INTCTRLA, 0, &TCD1.INTFLAGS, TC1_OVFIF_bm, 0 },
+	{ sim_TCD1_CCA_vect, &TCD1.INTCTRLB, 0, &TCD1.INTFLAGS, TC1_CCAIF_bm, 0 },
+	{ sim_SPID_INT_vect, &SPID.INTCTRL,  0, &SPID.STATUS,   SPI_IF_bm, 0 },
+	{ sim_USARTD0_DRE_vect, &USARTD0.CTRLA, 0, &USARTD0.STATUS, USART_DREIF_bm, 1 },
+};
+
+static void sim_advance(uint64_t cycles);
+static void sim_usart_next(uint8_t i);
+static void sim_dma_trigger(uint8_t trigsrc);
+
+/*
+ * Runs the highest pending interrupt above the running level, until
+ * there is none left.
+ */
+static void sim_dispatch(void)
+{
+	for (;;) {
+		const sim_source_t *best = NULL;
+		uint8_t best_level = sim_level;
+
+		if (!(sim_sreg.value & CPU_I_bm))
+			return;
+		for (const sim_source_t &s : sim_sources) {
+			uint8_t level = (s.intctrl->value >> s.shift) & 0x03;
+
+			if (level > best_level && s.isr && (s.flags->value & s.flag_bm) &&
+			    (PMIC.CTRL.value & (1 << (level - 1)))) {
+				best = &s;
+				best_level = level;
+			}
+		}
+		if (best == NULL)
+			return;
+
+		uint8_t saved = sim_level;
+
+		sim_level = best_level;
+		if (!best->state)
+			best->flags->value &= (uint8_t)~best->flag_bm;	// cleared by the vector
+		sim_advance(SIM_ISR_CYCLES);
+		best->isr();
+		sim_level = saved;
+	}
+}
+
+static uint16_t sim_tc_div(const TC0_t *tc)
+{
+	static const uint16_t div[8] = { 0, 1, 2, 4, 8, 64, 256, 1024 };
+	uint8_t clksel = tc->CTRLA.value & TC_CLKSEL_gm;
+
+	return clksel < 8 ? div[clksel] : 0;	// event clocks count in sim_tc_event()
+}
+
+static uint16_t sim_tc_top(const TC0_t *tc)
+{
+	return tc->CNT.value <= tc->PER.value ? tc->PER.value : 0xFFFF;
+}
+
+/*
+ * Loads PER and CCA from their buffers, as at an overflow.
+ */
+static void sim_tc_update(TC0_t *tc)
+{
+	if (tc->CTRLGSET.value & TC0_PERBV_bm)
+		tc->PER.value = tc->PERBUF.value;
+	if (tc->CTRLGSET.value & TC0_CCABV_bm)
+		tc->CCA.value = tc->CCABUF.value;
+	tc->CTRLGSET.value = tc->CTRLGCLR.value = 0;
+}
+
+static void sim_tc_event(uint8_t i);
+
+/*
+ * Overflow of timer i: the flag, the buffered registers and the overflow
+ * event, which clocks the timers on the event channels it is routed to.
+ */
+static void sim_tc_overflow(uint8_t i)
+{
+	TC0_t *tc = sim_tcs[i];
+
+	tc->INTFLAGS.value |= TC0_OVFIF_bm;
+	sim_tc_update(tc);
+	for (uint8_t ch = 0; ch < 8; ch++) {
+		if ((&EVSYS.CH0MUX)[ch].value != sim_tc_ovf_mux[i])
+			continue;
+		for (uint8_t j = 0; j < SIM_TCS; j++)
+			if ((sim_tcs[j]->CTRLA.value & TC_CLKSEL_gm) == TC_CLKSEL_EVCH0_gc + ch)
+				sim_tc_event(j);
+	}
+}
+
+/*
+ * One count of timer i, clocked by an event channel.
+ */
+static void sim_tc_event(uint8_t i)
+{
+	TC0_t *tc = sim_tcs[i];
+
+	if (tc->CNT.value >= sim_tc_top(tc)) {
+		tc->CNT.value = 0;
+		sim_tc_overflow(i);
+	} else {
+		tc->CNT.value++;
+	}
+	if (tc->CNT.value == tc->CCA.value)
+		tc->INTFLAGS.value |= TC0_CCAIF_bm;
+}
+
+/*
+ * Returns the cycles until the next overflow or compare match of timer i.
+ */
+static uint64_t sim_tc_next(uint8_t i)
+{
+	TC0_t *tc = sim_tcs[i];
+	uint16_t div = sim_tc_div(tc);
+	uint32_t top, ticks;
+
+	if (div == 0)
+		return SIM_NEVER;
+	top = sim_tc_top(tc);
+	ticks = top + 1 - tc->CNT.value;
+	if (tc->CCA.value > tc->CNT.value && tc->CCA.value <= top)
+		ticks = std::min<uint32_t>(ticks, tc->CCA.value - tc->CNT.value);
+	return (uint64_t)ticks * div - sim_tc_pre[i];
+}
+
+/*
+ * Lets timer i run for cycles, which does not pass its next event.
+ */
+static void sim_tc_step(uint8_t i, uint64_t cycles)
+{
+	TC0_t *tc = sim_tcs[i];
+	uint16_t div = sim_tc_div(tc);
+	uint32_t top, cnt;
+	uint64_t pre;
+
+	if (div == 0)
+		return;
+	pre = sim_tc_pre[i] + cycles;
+	sim_tc_pre[i] = pre % div;
+	top = sim_tc_top(tc);
+	cnt = tc->CNT.value + pre / div;
+	tc->CNT.value = cnt > top ? 0 : cnt;
+	if (cnt > top)
+		sim_tc_overflow(i);
+	if (tc->CNT.value == tc->CCA.value && pre >= div)
+		tc->INTFLAGS.value |= TC0_CCAIF_bm;
+}
+
+/*
+ * Moves the clock forward. Interrupts that become pending are run at
+ * once; the time they take is added, as they also stretch a delay loop
+ * on the real part.
+ */
+static void sim_advance(uint64_t cycles)
+{
+	while (cycles > 0) {
+		uint64_t step = cycles;
+
+		for (uint8_t i = 0; i < SIM_TCS; i++)
+			step = std::min(step, sim_tc_next(i));
+		for (uint8_t i = 0; i < SIM_SPIS; i++)
+			if (sim_spi[i].busy)
+				step = std::min(step, sim_spi[i].done - sim_time);
+		for (uint8_t i = 0; i < SIM_USARTS; i++)
+			if (sim_usart[i].busy)
+				step = std::min(step, sim_usart[i].done - sim_time);
+
+		sim_time += step;
+		cycles -= step;
+		if (sim_level)
+			sim_isr_time += step;
+		for (uint8_t i = 0; i < SIM_TCS; i++)
+			sim_tc_step(i, step);
+		for (uint8_t i = 0; i < SIM_SPIS; i++) {
+			if (sim_spi[i].busy && sim_spi[i].done <= sim_time) {
+				sim_spi[i].busy = 0;
+				sim_spi[i].unread = 1;
+				sim_spis[i]->STATUS.value |= SPI_IF_bm;
+				sim_dma_trigger(sim_spi_trigsrc[i]);
+			}
+		}
+		for (uint8_t i = 0; i < SIM_USARTS; i++)
+			if (sim_usart[i].busy && sim_usart[i].done <= sim_time)
+				sim_usart_next(i);
+		sim_dispatch();
+	}
+	sim_dispatch();
+}
+
+static void sim_record(uint8_t kind, uint8_t unit, uint8_t value, uint8_t old)
+{
+	if (sim_tracing) {
+		sim_event_t e = { sim_time, kind, unit, value, old };
+		sim_trace_events.push_back(e);
+	}
+}
+
+/*
+ * Tells the devices about changed output levels of a port.
+ */
+static void sim_port_changed(uint8_t port)
+{
+	PORT_t *p = sim_ports[port];
+	uint8_t now = p->OUT.value & p->DIR.value;
+	uint8_t old = sim_port_out[port];
+
+	if (now == old)
+		return;
+	sim_port_out[port] = now;
+	sim_record(SIM_EDGE, port, now, old);
+	for (sim_device *d : sim_devices)
+		d->pins(port, old, now);
+}
+
+static uint8_t sim_port_in(uint8_t port)
+{
+	PORT_t *p = sim_ports[port];
+	uint8_t in = p->OUT.value & p->DIR.value;
+
+	for (sim_device *d : sim_devices) {
+		uint8_t level = 0;
+		uint8_t mask = d->drive(port, &level) & (uint8_t)~p->DIR.value;
+
+		in = (in & (uint8_t)~mask) | (level & mask);
+	}
+	return in;
+}
+
+static uint8_t sim_vport_map(uint8_t vport)
+{
+	uint8_t ctrl = vport < 2 ? PORTCFG.VPCTRLA.value : PORTCFG.VPCTRLB.value;
+	uint8_t map = (vport & 1) ? ctrl >> 4 : ctrl & 0x0F;
+
+	return map < SIM_PORTR ? map : (uint8_t)SIM_PORTR;
+}
+
+static uint8_t sim_port_read(uint8_t port, size_t off)
+{
+	PORT_t *p = sim_ports[port];
+
+	switch (off) {
+	case offsetof(PORT_t, DIRSET): case offsetof(PORT_t, DIRCLR): case offsetof(PORT_t, DIRTGL):
+		return p->DIR.value;
+	case offsetof(PORT_t, OUTSET): case offsetof(PORT_t, OUTCLR): case offsetof(PORT_t, OUTTGL):
+		return p->OUT.value;
+	case offsetof(PORT_t, IN):
+		return sim_port_in(port);
+	default:
+		return ((register8_t *)p)[off].value;
+	}
+}
+
+static void sim_port_write(uint8_t port, size_t off, uint8_t v)
+{
+	PORT_t *p = sim_ports[port];
+
+	switch (off) {
+	case offsetof(PORT_t, DIR):    p->DIR.value = v; break;
+	case offsetof(PORT_t, DIRSET): p->DIR.value |= v; break;
+	case offsetof(PORT_t, DIRCLR): p->DIR.value &= (uint8_t)~v; break;
+	case offsetof(PORT_t, DIRTGL): p->DIR.value ^= v; break;
+	case offsetof(PORT_t, OUT):    p->OUT.value = v; break;
+	case offsetof(PORT_t, OUTSET): p->OUT.value |= v; break;
+	case offsetof(PORT_t, OUTCLR): p->OUT.value &= (uint8_t)~v; break;
+	case offsetof(PORT_t, OUTTGL): p->OUT.value ^= v; break;
+	case offsetof(PORT_t, IN):     return;
+	case offsetof(PORT_t, INTFLAGS): p->INTFLAGS.value &= (uint8_t)~v; return;
+	default: ((register8_t *)p)[off].value = v; return;
+	}
+	sim_port_changed(port);
+}
+
+static uint8_t sim_spi_div(const SPI_t *spi)
+{
+	static const uint8_t div[4] = { 4, 16, 64, 128 };
+	uint8_t d = div[spi->CTRL.value & SPI_PRESCALER_gm];
+
+	return (spi->CTRL.value & SPI_CLK2X_bm) ? d / 2 : d;
+}
+
+static void sim_spi_write(uint8_t i, uint8_t v)
+{
+	SPI_t *spi = sim_spis[i];
+	uint8_t rx = 0xFF;
+
+	if (!(spi->CTRL.value & SPI_ENABLE_bm) || !(spi->CTRL.value & SPI_MASTER_bm))
+		return;
+	if (sim_spi[i].busy) {
+		spi->STATUS.value |= SPI_WRCOL_bm;
+		return;
+	}
+	if (sim_spi[i].unread)
+		sim_spi[i].lost++;
+	for (sim_device *d : sim_devices)
+		rx &= d->spi(i, v);
+	sim_record(SIM_SPI, i, v, rx);
+	spi->STATUS.value &= (uint8_t)~(SPI_IF_bm | SPI_WRCOL_bm);
+	sim_spi[i].busy = 1;
+	sim_spi[i].done = sim_time + 8 * sim_spi_div(spi);
+	sim_spi[i].rx = rx;
+}
+
+/*
+ * Cycles of one frame: start bit, 8 data bits and stop bit. BSCALE is
+ * not modelled.
+ */
+static uint64_t sim_usart_frame(const USART_t *usart)
+{
+	uint16_t bsel = usart->BAUDCTRLA.value | (usart->BAUDCTRLB.value & 0x0F) << 8;
+
+	return 10 * ((usart->CTRLB.value & USART_CLK2X_bm) ? 8 : 16) * (uint64_t)(bsel + 1);
+}
+
+static void sim_usart_start(uint8_t i, uint8_t v)
+{
+	USART_t *usart = sim_usarts[i];
+
+	for (sim_device *d : sim_devices)
+		d->usart(i, v);
+	sim_record(SIM_USART, i, v, 0);
+	usart->STATUS.value &= (uint8_t)~USART_TXCIF_bm;
+	sim_usart[i].busy = 1;
+	sim_usart[i].done = sim_time + sim_usart_frame(usart);
+}
+
+/*
+ * End of a frame: the byte waiting in DATA moves to the shift register.
+ */
+static void sim_usart_next(uint8_t i)
+{
+	USART_t *usart = sim_usarts[i];
+
+	sim_usart[i].busy = 0;
+	if (sim_usart[i].full) {
+		sim_usart[i].full = 0;
+		usart->STATUS.value |= USART_DREIF_bm;
+		sim_usart_start(i, sim_usart[i].data);
+	} else {
+		usart->STATUS.value |= USART_TXCIF_bm;
+	}
+}
+
+static void sim_usart_write(uint8_t i, uint8_t v)
+{
+	USART_t *usart = sim_usarts[i];
+
+	if (!(usart->CTRLB.value & USART_TXEN_bm) || sim_usart[i].full)
+		return;								// a write to a full DATA is lost
+	if (!sim_usart[i].busy) {
+		sim_usart_start(i, v);
+		return;
+	}
+	sim_usart[i].full = 1;
+	sim_usart[i].data = v;
+	usart->STATUS.value &= (uint8_t)~USART_DREIF_bm;
+}
+
+static void sim_tc_write(uint8_t i, size_t off, uint8_t v)
+{
+	TC0_t *tc = sim_tcs[i];
+
+	switch (off) {
+	case offsetof(TC0_t, CTRLA):
+		tc->CTRLA.value = v;
+		if ((v & TC_CLKSEL_gm) == TC_CLKSEL_OFF_gc)
+			sim_tc_pre[i] = 0;
+		break;
+	case offsetof(TC0_t, CTRLFSET):
+		if ((v & TC_CMD_gm) == TC_CMD_RESTART_gc) {
+			tc->CNT.value = 0;
+			sim_tc_pre[i] = 0;
+		} else if ((v & TC_CMD_gm) == TC_CMD_UPDATE_gc) {
+			sim_tc_update(tc);
+		}
+		tc->CTRLFSET.value |= v & (uint8_t)~TC_CMD_gm;
+		tc->CTRLFCLR.value = tc->CTRLFSET.value;
+		break;
+	case offsetof(TC0_t, CTRLFCLR):
+		tc->CTRLFSET.value &= (uint8_t)~v;
+		tc->CTRLFCLR.value = tc->CTRLFSET.value;
+		break;
+	case offsetof(TC0_t, CTRLGSET):
+		tc->CTRLGSET.value |= v;
+		tc->CTRLGCLR.value = tc->CTRLGSET.value;
+		break;
+	case offsetof(TC0_t, CTRLGCLR):
+		tc->CTRLGSET.value &= (uint8_t)~v;
+		tc->CTRLGCLR.value = tc->CTRLGSET.value;
+		break;
+	case offsetof(TC0_t, INTFLAGS):
+		tc->INTFLAGS.value &= (uint8_t)~v;
+		break;
+	default:
+		((register8_t *)tc)[off].value = v;
+		break;
+	}
+}
+
+static void sim_tc_write16(uint8_t i, size_t off, uint16_t v)
+{
+	TC0_t *tc = sim_tcs[i];
+
+	*(uint16_t *)((uint8_t *)tc + off) = v;
+	if (off == offsetof(TC0_t, PERBUF))
+		tc->CTRLGSET.value |= TC0_PERBV_bm;
+	else if (off == offsetof(TC0_t, CCABUF))
+		tc->CTRLGSET.value |= TC0_CCABV_bm;
+	else
+		return;
+	tc->CTRLGCLR.value = tc->CTRLGSET.value;
+}
+
+enum { SIM_REG_PORT, SIM_REG_VPORT, SIM_REG_SPI, SIM_REG_USART, SIM_REG_TC, SIM_REG_DMA, SIM_REG_OSC, SIM_REG_CPU,
+       SIM_REG_PLAIN };
+
+/*
+ * Finds the peripheral of a register, returns its kind and sets its unit
+ * and the offset of the register in the peripheral.
+ */
+static uint8_t sim_find(const volatile void *reg, uint8_t *unit, size_t *off)
+{
+	const uint8_t *r = (const uint8_t *)reg;
+
+#define SIM_IN(obj)	(r >= (const uint8_t *)&(obj) && r < (const uint8_t *)&(obj) + sizeof(obj) && \
+					 (*off = r - (const uint8_t *)&(obj), 1))
+	for (uint8_t i = 0; i < SIM_PORTS; i++)
+		if (SIM_IN(*sim_ports[i]))
+			return *unit = i, SIM_REG_PORT;
+	for (uint8_t i = 0; i < 4; i++)
+		if (SIM_IN(*sim_vports[i]))
+			return *unit = i, SIM_REG_VPORT;
+	for (uint8_t i = 0; i < SIM_SPIS; i++)
+		if (SIM_IN(*sim_spis[i]))
+			return *unit = i, SIM_REG_SPI;
+	for (uint8_t i = 0; i < SIM_USARTS; i++)
+		if (SIM_IN(*sim_usarts[i]))
+			return *unit = i, SIM_REG_USART;
+	for (uint8_t i = 0; i < SIM_TCS; i++)
+		if (SIM_IN(*sim_tcs[i]))
+			return *unit = i, SIM_REG_TC;
+	if (SIM_IN(DMA))
+		return SIM_REG_DMA;
+	if (SIM_IN(OSC))
+		return SIM_REG_OSC;
+	if (SIM_IN(sim_sreg))
+		return SIM_REG_CPU;
+#undef SIM_IN
+	*off = 0;
+	return SIM_REG_PLAIN;
+}
+
+/*
+ * Returns the port a virtual port register maps on and the offset of the
+ * matching port register.
+ */
+static uint8_t sim_vport(uint8_t vport, size_t *off)
+{
+	static const size_t port_off[4] = {
+		offsetof(PORT_t, DIR), offsetof(PORT_t, OUT), offsetof(PORT_t, IN), offsetof(PORT_t, INTFLAGS)
+	};
+
+	*off = port_off[*off];
+	return sim_vport_map(vport);
+}
+
+static uint8_t sim_access_cycles(uint8_t kind)
+{
+	return (kind == SIM_REG_VPORT || kind == SIM_REG_CPU) ? SIM_VPORT_CYCLES : SIM_IO_CYCLES;
+}
+
+/*
+ * A load of reg, without the time it takes.
+ */
+static uint8_t sim_load(const volatile void *reg, uint8_t kind, uint8_t unit, size_t off)
+{
+	switch (kind) {
+	case SIM_REG_VPORT:
+		unit = sim_vport(unit, &off);
+		return sim_port_read(unit, off);
+	case SIM_REG_PORT:
+		return sim_port_read(unit, off);
+	case SIM_REG_SPI:
+		if (off == offsetof(SPI_t, DATA)) {
+			sim_spis[unit]->STATUS.value &= (uint8_t)~(SPI_IF_bm | SPI_WRCOL_bm);
+			sim_spi[unit].unread = 0;
+			return sim_spi[unit].rx;
+		}
+		break;
+	case SIM_REG_OSC:
+		if (off == offsetof(OSC_t, STATUS))
+			return OSC.CTRL.value;				// every enabled oscillator is stable
+		break;
+	}
+	return ((const register8_t *)reg)->value;
+}
+
+uint8_t sim_read8(const volatile void *reg)
+{
+	uint8_t unit = 0;
+	size_t off;
+	uint8_t kind = sim_find(reg, &unit, &off);
+
+	sim_advance(sim_access_cycles(kind));
+	return sim_load(reg, kind, unit, off);
+}
+
+/*
+ * A store to reg, without the time it takes.
+ */
+static void sim_store(volatile void *reg, uint8_t kind, uint8_t unit, size_t off, uint8_t value)
+{
+	switch (kind) {
+	case SIM_REG_VPORT:
+		unit = sim_vport(unit, &off);
+		sim_port_write(unit, off, value);
+		return;
+	case SIM_REG_PORT:
+		sim_port_write(unit, off, value);
+		return;
+	case SIM_REG_SPI:
+		if (off == offsetof(SPI_t, DATA)) {
+			sim_spi_write(unit, value);
+			return;
+		}
+		if (off == offsetof(SPI_t, STATUS))
+			return;
+		break;
+	case SIM_REG_USART:
+		if (off == offsetof(USART_t, DATA)) {
+			sim_usart_write(unit, value);
+			return;
+		}
+		if (off == offsetof(USART_t, STATUS)) {
+			sim_usarts[unit]->STATUS.value &= (uint8_t)~(value & USART_TXCIF_bm);
+			return;
+		}
+		break;
+	case SIM_REG_TC:
+		sim_tc_write(unit, off, value);
+		return;
+	case SIM_REG_DMA:
+		if (off >= offsetof(DMA_t, CH0) &&
+		    (off - offsetof(DMA_t, CH0)) % sizeof(DMA_CH_t) == offsetof(DMA_CH_t, CTRLB)) {
+			uint8_t flags = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
+			register8_t *ctrlb = (register8_t *)reg;
+
+			ctrlb->value = (ctrlb->value & flags & (uint8_t)~value) | (value & (uint8_t)~flags);
+			return;
+		}
+		break;
+	}
+	((register8_t *)reg)->value = value;
+}
+
+void sim_write8(volatile void *reg, uint8_t value, uint8_t rmw)
+{
+	uint8_t unit = 0;
+	size_t off;
+	uint8_t kind = sim_find(reg, &unit, &off);
+
+	if (!rmw)
+		sim_advance(sim_access_cycles(kind));
+	sim_store(reg, kind, unit, off, value);
+}
+
+/*
+ * Host address of the 24 bit address in addr[0..2]. The firmware writes
+ * the low 24 bits of a host pointer. The variables of a program lie
+ * within a few MB of each other, so the upper bits are those of DMA.
+ */
+static uint8_t *sim_dma_ptr(const register8_t *addr)
+{
+	uintptr_t ref = (uintptr_t)&DMA;
+	uintptr_t p = (ref & ~(uintptr_t)0xFFFFFF) |
+	              addr[0].value | addr[1].value << 8 | (uintptr_t)addr[2].value << 16;
+
+	if (p > ref + 0x800000)
+		p -= 0x1000000;
+	else if (p + 0x800000 < ref)
+		p += 0x1000000;
+	return (uint8_t *)p;
+}
+
+static void sim_dma_set(register8_t *addr, const uint8_t *p)
+{
+	addr[0].value = (uintptr_t)p & 0xFF;
+	addr[1].value = (uintptr_t)p >> 8 & 0xFF;
+	addr[2].value = (uintptr_t)p >> 16 & 0xFF;
+}
+
+/*
+ * One single shot burst of one byte on channel ch. The data take no
+ * CPU time.
+ */
+static void sim_dma_byte(DMA_CH_t *ch)
+{
+	uint8_t *src = sim_dma_ptr(&ch->SRCADDR0);
+	uint8_t *dest = sim_dma_ptr(&ch->DESTADDR0);
+	uint8_t unit = 0;
+	size_t off;
+	uint8_t kind, v;
+
+	kind = sim_find(src, &unit, &off);
+	v = sim_load(src, kind, unit, off);
+	kind = sim_find(dest, &unit, &off);
+	sim_store(dest, kind, unit, off, v);
+	if ((ch->ADDRCTRL.value & DMA_CH_SRCDIR_gm) == DMA_CH_SRCDIR_INC_gc)
+		sim_dma_set(&ch->SRCADDR0, src + 1);
+	if ((ch->ADDRCTRL.value & DMA_CH_DESTDIR_gm) == DMA_CH_DESTDIR_INC_gc)
+		sim_dma_set(&ch->DESTADDR0, dest + 1);
+	if (--ch->TRFCNT.value == 0) {
+		ch->CTRLA.value &= (uint8_t)~DMA_CH_ENABLE_bm;
+		ch->CTRLB.value |= DMA_CH_TRNIF_bm;
+	}
+}
+
+/*
+ * A trigger starts one burst on every enabled channel with that trigger
+ * source, channel 0 first. Only single shot bursts of one byte and the
+ * fixed priority are modelled.
+ */
+static void sim_dma_trigger(uint8_t trigsrc)
+{
+	if (!(DMA.CTRL.value & DMA_ENABLE_bm))
+		return;
+	for (DMA_CH_t *ch : sim_dma_chs)
+		if ((ch->CTRLA.value & DMA_CH_ENABLE_bm) && ch->TRIGSRC.value == trigsrc)
+			sim_dma_byte(ch);
+}
+
+uint16_t sim_read16(const volatile void *reg)
+{
+	sim_advance(2 * SIM_IO_CYCLES);
+	return ((const register16_t *)reg)->value;
+}
+
+void sim_write16(volatile void *reg, uint16_t value)
+{
+	uint8_t unit = 0;
+	size_t off;
+
+	sim_advance(2 * SIM_IO_CYCLES);
+	if (sim_find(reg, &unit, &off) == SIM_REG_TC)
+		sim_tc_write16(unit, off, value);
+	else
+		((register16_t *)reg)->value = value;
+}
+
+void sim_delay_cycles(double cycles)
+{
+	sim_advance((uint64_t)ceil(cycles));
+}
+
+/*
+ * Clears all registers, the clock and the trace. Attached devices stay.
+ */
+void sim_reset(void)
+{
+	for (PORT_t *p : sim_ports)
+		memset((void *)p, 0, sizeof(*p));
+	for (VPORT_t *p : sim_vports)
+		memset((void *)p, 0, sizeof(*p));
+	for (SPI_t *p : sim_spis)
+		memset((void *)p, 0, sizeof(*p));
+	for (USART_t *p : sim_usarts) {
+		memset((void *)p, 0, sizeof(*p));
+		p->STATUS.value = USART_DREIF_bm;
+	}
+	for (TC0_t *p : sim_tcs) {
+		memset((void *)p, 0, sizeof(*p));
+		p->PER.value = p->CCA.value = 0xFFFF;
+	}
+	memset((void *)&EVSYS, 0, sizeof(EVSYS));
+	memset((void *)&DMA, 0, sizeof(DMA));
+	memset((void *)&PORTCFG, 0, sizeof(PORTCFG));
+	memset((void *)&PMIC, 0, sizeof(PMIC));
+	memset((void *)&OSC, 0, sizeof(OSC));
+	sim_sreg.value = 0;
+	memset(sim_port_out, 0, sizeof(sim_port_out));
+	memset(sim_spi, 0, sizeof(sim_spi));
+	memset(sim_usart, 0, sizeof(sim_usart));
+	memset(sim_tc_pre, 0, sizeof(sim_tc_pre));
+	sim_time = 0;
+	sim_isr_time = 0;
+	sim_level = 0;
+	sim_trace_events.clear();
+}
+
+void sim_attach(sim_device *device)
+{
+	sim_devices.push_back(device);
+}
+
+void sim_detach(sim_device *device)
+{
+	sim_devices.erase(std::remove(sim_devices.begin(), sim_devices.end(), device), sim_devices.end());
+}
+
+uint64_t sim_now(void)
+{
+	return sim_time;
+}
+
+double sim_us(uint64_t cycles)
+{
+	return cycles * 1e6 / F_CPU;
+}
+
+uint64_t sim_cycles(double us)
+{
+	return (uint64_t)ceil(us * (F_CPU / 1e6));
+}
+
+/*
+ * Lets the part run for cycles, as if the main program waits.
+ */
+void sim_run(uint64_t cycles)
+{
+	sim_advance(cycles);
+}
+
+uint64_t sim_isr_cycles(void)
+{
+	return sim_isr_time;
+}
+
+/*
+ * sleep_cpu(): runs until an interrupt has run. With the interrupts
+ * disabled nothing can wake the part, the program ends.
+ */
+void sim_sleep(void)
+{
+	uint64_t isr = sim_isr_time;
+
+	if (!(sim_sreg.value & CPU_I_bm))
+		exit(0);
+	while (sim_isr_time == isr)
+		sim_advance(1);
+}
+
+uint8_t sim_port_index(const PORT_t *port)
+{
+	for (uint8_t i = 0; i < SIM_PORTS; i++)
+		if (sim_ports[i] == port)
+			return i;
+	return SIM_PORTS;
+}
+
+/*
+ * Returns the levels of a port as seen on the pins.
+ */
+uint8_t sim_port_pins(uint8_t port)
+{
+	return sim_port_in(port);
+}
+
+uint8_t sim_spi_busy(uint8_t spi)
+{
+	return sim_spi[spi].busy;
+}
+
+/*
+ * Returns the bytes of SPI master spi that were received but not read
+ * from DATA before the next byte was written.
+ */
+uint32_t sim_spi_lost(uint8_t spi)
+{
+	return sim_spi[spi].lost;
+}
+
+void sim_trace(uint8_t on)
+{
+	sim_tracing = on;
+}
+
+const std::vector<sim_event_t> &sim_events(void)
+{
+	return sim_trace_events;
+}
+
+void sim_trace_clear(void)
+{
+	sim_trace_events.clear();
+}
+
+void sim_trace_dump(FILE *f)
+{
+	static const char *const port_names[SIM_PORTS] = { "PORTA", "PORTB", "PORTC", "PORTD", "PORTE", "PORTR" };
+	static const char *const spi_names[SIM_SPIS] = { "SPIC", "SPID" };
+	static const char *const usart_names[SIM_USARTS] = { "USARTC0", "USARTD0" };
+
+	for (const sim_event_t &e : sim_trace_events) {
+		if (e.kind == SIM_EDGE)
+			fprintf(f, "%12.3f us  %-5s  %02X -> %02X\n", sim_us(e.time), port_names[e.unit], e.old, e.value);
+		else if (e.kind == SIM_SPI)
+			fprintf(f, "%12.3f us  %-5s  > %02X  < %02X\n", sim_us(e.time), spi_names[e.unit], e.value, e.old);
+		else
+			fprintf(f, "%12.3f us  %-7s  > %02X\n", sim_us(e.time), usart_names[e.unit], e.value);
+	}
+}
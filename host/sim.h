@@ -0,0 +1,86 @@
+/*
+ * sim.h
+ *
+ * Register model of the ATxmega128A4U for running the drivers on a host.
+ *
+ * Time is counted in CPU cycles of F_CPU. It advances by SIM_IO_CYCLES
+ * for every register access (SIM_VPORT_CYCLES for a virtual port), by
+ * the exact number of cycles of _delay_us() and _delay_ms(), and by
+ * sim_run(). Code between register accesses takes no time, so the times
+ * are a lower bound for the CPU and exact for the delays on the bus.
+ * A busy loop must touch a register or call sim_run(), otherwise the
+ * clock stands still.
+ *
+ * Modelled are the ports with their virtual ports, the SPI masters, the
+ * transmitters of the USARTs with their data register empty interrupt,
+ * the normal mode of the timers with PERBUF/CCABUF, the overflow and
+ * compare A interrupts, the PMIC levels and single shot one byte DMA
+ * bursts triggered by the SPI masters. Other registers are plain
+ * storage. Every change of an output pin, every SPI byte and every sent
+ * USART byte is recorded in the trace with its time.
+ *
+ * Simulated devices derive from sim_device and see the pins, the SPI
+ * bytes and the sent USART bytes. They can drive port pins that are
+ * inputs.
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include <avr/io.h>
+
+#define SIM_IO_CYCLES		2				// cycles of an lds/sts to an I/O register
+#define SIM_VPORT_CYCLES	1				// cycles of an in/out/sbi/cbi to a virtual port
+#define SIM_ISR_CYCLES		24				// entry, prologue, epilogue and reti of an ISR
+
+enum { SIM_PORTA, SIM_PORTB, SIM_PORTC, SIM_PORTD, SIM_PORTE, SIM_PORTR, SIM_PORTS };
+enum { SIM_SPIC, SIM_SPID, SIM_SPIS };
+enum { SIM_USARTC0, SIM_USARTD0, SIM_USARTS };
+
+enum sim_kind { SIM_EDGE, SIM_SPI, SIM_USART };
+
+typedef struct {
+	uint64_t time;							// cycles
+	uint8_t kind;							// SIM_EDGE, SIM_SPI or SIM_USART
+	uint8_t unit;							// port, SPI or USART number
+	uint8_t value;							// pin levels after the edge, byte sent
+	uint8_t old;							// pin levels before the edge, byte received
+} sim_event_t;
+
+class sim_device {
+public:
+	virtual ~sim_device() {}
+	// Output levels (OUT & DIR) of a port changed.
+	virtual void pins(uint8_t port, uint8_t old, uint8_t now) { (void)port; (void)old; (void)now; }
+	// Returns the mask of pins of port the device drives and their levels.
+	virtual uint8_t drive(uint8_t port, uint8_t *level) { (void)port; (void)level; return 0; }
+	// Byte shifted out by SPI master spi, returns the byte shifted in.
+	virtual uint8_t spi(uint8_t spi, uint8_t mosi) { (void)spi; (void)mosi; return 0xFF; }
+	// Byte sent by USART usart, when its start bit goes out.
+	virtual void usart(uint8_t usart, uint8_t tx) { (void)usart; (void)tx; }
+};
+
+void sim_reset(void);
+void sim_attach(sim_device *device);
+void sim_detach(sim_device *device);
+
+uint64_t sim_now(void);
+double sim_us(uint64_t cycles);
+uint64_t sim_cycles(double us);
+void sim_run(uint64_t cycles);
+uint64_t sim_isr_cycles(void);
+
+uint8_t sim_port_index(const PORT_t *port);
+uint8_t sim_port_pins(uint8_t port);
+uint8_t sim_spi_busy(uint8_t spi);
+uint32_t sim_spi_lost(uint8_t spi);
+
+void sim_trace(uint8_t on);
+const std::vector<sim_event_t> &sim_events(void);
+void sim_trace_clear(void);
+void sim_trace_dump(FILE *f);
+
+#endif /* SIM_H_ */
@@ -0,0 +1,193 @@
+/*
+ * tracedecode.cpp
+ *
+ * Decodes the event frames of trace.c, as captured from the USART, and
+ * prints the count, the minimum, mean and maximum time and a histogram
+ * of the time between the begin and the end of every event.
+ *
+ * usage: tracedecode [-u us_per_count] [file]
+ *
+ * us_per_count is TRACE_TC_DIV / F_CPU in us, 0.25 by default. Without a
+ * file the frames are read from stdin. The exit status is 1 when the
+ * stream has bytes outside the frames, or a begin or end without its
+ * partner that is not explained by lost records.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define TRACE_SYNC		0xA5				// see trace.h
+#define TRACE_END_bm	0x80
+#define TRACE_LOST		0
+#define TRACE_EVENTS	8
+#define TRACE_DEPTH		4					// nesting of one event, e.g. by an interrupt
+#define BUCKETS			18					// < 1 us, powers of two up to 65 ms, longer
+
+static const char *const names[TRACE_EVENTS] = {
+	"lost", "lcd byte", "lcd_clear", "lcd_home", "spi_transfer", "spi_transfer_block",
+	"matrix row", "matrix blank",
+};
+
+typedef struct {
+	uint16_t begin[TRACE_DEPTH];			// timestamps of the open begins
+	uint8_t open;
+	uint8_t gap;							// records were lost since the last begin
+	uint32_t count;
+	uint32_t unmatched;
+	double min, max, total;
+	uint32_t histogram[BUCKETS];
+} event_t;
+
+static event_t events[TRACE_EVENTS];
+static double us_per_count = 0.25;
+static uint32_t lost = 0;
+static uint32_t skipped = 0;				// bytes outside the frames
+static uint32_t frames = 0;
+
+static void record(uint8_t code, uint16_t time)
+{
+	uint8_t id = code & ~TRACE_END_bm;
+	event_t *e;
+	double us;
+	uint8_t b;
+
+	if (id == TRACE_LOST) {
+		lost += time;
+		for (event_t &ev : events) {
+			ev.open = 0;
+			ev.gap = 1;
+		}
+		return;
+	}
+	e = &events[id];
+	if (!(code & TRACE_END_bm)) {
+		if (e->open == TRACE_DEPTH) {
+			e->unmatched++;
+			return;
+		}
+		e->begin[e->open++] = time;
+		e->gap = 0;
+		return;
+	}
+	if (e->open == 0) {
+		if (!e->gap)						// its begin may be in the gap
+			e->unmatched++;
+		return;
+	}
+	us = (uint16_t)(time - e->begin[--e->open]) * us_per_count;
+	if (e->count == 0 || us < e->min)
+		e->min = us;
+	if (us > e->max)
+		e->max = us;
+	e->total += us;
+	e->count++;
+	for (b = 0; b < BUCKETS - 1 && us >= (1 << b); b++)
+		;
+	e->histogram[b]++;
+}
+
+/*
+ * Reads the frames. A frame with an unknown event is not a frame, the
+ * search for the next TRACE_SYNC starts at its second byte.
+ */
+static void decode(const std::vector<uint8_t> &in)
+{
+	size_t i = 0;
+
+	while (i < in.size()) {
+		size_t n, end;
+		bool ok = true;
+
+		if (in[i] != TRACE_SYNC) {
+			skipped++;
+			i++;
+			continue;
+		}
+		if (i + 2 > in.size() || (end = i + 2 + 3 * (n = in[i + 1])) > in.size())
+			break;							// cut off at the end of the capture
+		for (size_t r = 0; r < n; r++)
+			ok = ok && (in[i + 2 + 3 * r] & ~TRACE_END_bm) < TRACE_EVENTS;
+		if (n == 0 || !ok) {
+			skipped++;
+			i++;
+			continue;
+		}
+		for (size_t r = 0; r < n; r++) {
+			const uint8_t *p = &in[i + 2 + 3 * r];
+
+			record(p[0], p[1] | p[2] << 8);
+		}
+		frames++;
+		i = end;
+	}
+}
+
+/*
+ * Prints the events and returns the number of begins and ends without
+ * their partner.
+ */
+static uint32_t print(void)
+{
+	uint32_t unmatched = 0;
+	char label[32];
+
+	printf("%u frames, %u records lost, %u bytes skipped\n\n", frames, lost, skipped);
+	for (uint8_t id = 1; id < TRACE_EVENTS; id++) {
+		const event_t &e = events[id];
+		uint32_t most = 0;
+
+		unmatched += e.unmatched;
+		if (e.count == 0)
+			continue;
+		printf("%-20s %8u  min %9.2f  mean %9.2f  max %9.2f us\n", names[id], e.count,
+		       e.min, e.total / e.count, e.max);
+		for (uint8_t b = 0; b < BUCKETS; b++)
+			if (e.histogram[b] > most)
+				most = e.histogram[b];
+		for (uint8_t b = 0; b < BUCKETS; b++) {
+			if (e.histogram[b] == 0)
+				continue;
+			if (b == 0)
+				snprintf(label, sizeof(label), "< 1 us");
+			else if (b == BUCKETS - 1)
+				snprintf(label, sizeof(label), ">= %u us", 1u << (b - 1));
+			else
+				snprintf(label, sizeof(label), "%u - %u us", 1u << (b - 1), 1u << b);
+			printf("  %-18s %8u %s\n", label, e.histogram[b],
+			       std::string(e.histogram[b] * 39 / most + 1, '#').c_str());
+		}
+		printf("\n");
+	}
+	if (unmatched)
+		printf("%u begins or ends without their partner\n", unmatched);
+	return unmatched;
+}
+
+int main(int argc, char **argv)
+{
+	const char *file = NULL;
+	std::vector<uint8_t> in;
+	FILE *f = stdin;
+	int c;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-u") == 0 && i + 1 < argc)
+			us_per_count = atof(argv[++i]);
+		else
+			file = argv[i];
+	}
+	if (file && !(f = fopen(file, "rb"))) {
+		perror(file);
+		return 2;
+	}
+	while ((c = getc(f)) != EOF)
+		in.push_back(c);
+	if (file)
+		fclose(f);
+
+	decode(in);
+	return print() != 0 || skipped != 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * usartlog.h
+ *
+ * Simulated receiver on the TX line of a USART, see sim.h. Keeps every
+ * byte and writes them to a file, like a capture of a serial terminal.
+ */
+
+#ifndef USARTLOG_H_
+#define USARTLOG_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "sim.h"
+
+class usartlog : public sim_device {
+public:
+	explicit usartlog(uint8_t usart) : usart_(usart) {}
+
+	const std::vector<uint8_t> &bytes(void) const { return bytes_; }
+
+	bool save(const char *file) const
+	{
+		FILE *f = fopen(file, "wb");
+		bool ok;
+
+		if (!f)
+			return false;
+		ok = fwrite(bytes_.data(), 1, bytes_.size(), f) == bytes_.size();
+		return fclose(f) == 0 && ok;
+	}
+
+	void usart(uint8_t usart, uint8_t tx) override
+	{
+		if (usart == usart_)
+			bytes_.push_back(tx);
+	}
+
+private:
+	uint8_t usart_;
+	std::vector<uint8_t> bytes_;
+};
+
+#endif /* USARTLOG_H_ */
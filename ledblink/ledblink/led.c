@@ -0,0 +1,116 @@
+/*
+ * led.c
+ *
+ * LED pattern engine on timer, event system and DMA, see led.h.
+ */
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "led.h"
+
+static uint16_t led_steps[LED_MAX_STEPS];			// duty cycles, read by the DMA
+
+static const uint16_t led_gamma[16] PROGMEM = {		// perceived brightness 0 to 15
+	0, 3, 12, 30, 56, 91, 136, 191, 257, 333, 419, 517, 626, 747, 879, 1023
+};
+
+static void led_dma_addr(volatile register8_t *addr, const volatile void *p)
+{
+	addr[0] = (uint16_t)(uintptr_t)p & 0xFF;
+	addr[1] = (uint16_t)(uintptr_t)p >> 8;
+	addr[2] = 0;
+}
+
+void led_init(void)
+{
+	PORTE.DIRSET = PIN0_bm;
+	LED_TC.PER = LED_PWM_TOP;
+	LED_TC.CCA = 0;
+	LED_TC.CTRLB = TC0_CCAEN_bm | TC_WGMODE_SS_gc;
+	LED_TC.CTRLA = TC_CLKSEL_DIV1_gc;
+
+	EVSYS.CH0MUX = EVSYS_CHMUX_TCE0_OVF_gc;			// one event per PWM period
+	EVSYS.CH1MUX = EVSYS_CHMUX_TCD1_OVF_gc;			// one event per pattern step
+	LED_STEP_TC.CTRLA = TC_CLKSEL_EVCH0_gc;
+	DMA.CTRL |= DMA_ENABLE_bm;
+}
+
+/*
+ * Starts the count steps in led_steps, each step_ms long (at most 2 s).
+ */
+static void led_start(uint8_t count, uint16_t step_ms)
+{
+	LED_DMA.CTRLA = 0;
+	while (LED_DMA.CTRLA & DMA_CH_ENABLE_bm);		// wait for a running burst
+
+	LED_STEP_TC.PER = (uint32_t)step_ms * LED_PWM_HZ / 1000 - 1;
+	LED_STEP_TC.CNT = 0;
+	if (count == 1)
+	{
+		LED_TC.CCABUF = led_steps[0];				// constant level
+		return;
+	}
+
+	LED_DMA.ADDRCTRL = DMA_CH_SRCRELOAD_BLOCK_gc | DMA_CH_SRCDIR_INC_gc |
+	                   DMA_CH_DESTRELOAD_BURST_gc | DMA_CH_DESTDIR_INC_gc;
+	LED_DMA.TRIGSRC  = DMA_CH_TRIGSRC_EVSYS_CH1_gc;
+	LED_DMA.TRFCNT   = count * sizeof(uint16_t);
+	LED_DMA.REPCNT   = 0;							// repeat forever
+	led_dma_addr(&LED_DMA.SRCADDR0, led_steps);
+	led_dma_addr(&LED_DMA.DESTADDR0, &LED_TC.CCABUF);
+	LED_DMA.CTRLA    = DMA_CH_ENABLE_bm | DMA_CH_REPEAT_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_2BYTE_gc;
+	LED_DMA.CTRLA   |= DMA_CH_TRFREQ_bm;				// first step now
+}
+
+/*
+ * Plays the duty cycles (0 to LED_ON) one after the other, step_ms each,
+ * and starts over.
+ */
+void led_pattern(const uint16_t *duty, uint8_t count, uint16_t step_ms)
+{
+	if (count == 0 || count > LED_MAX_STEPS)
+		return;
+	memcpy(led_steps, duty, count * sizeof(uint16_t));
+	led_start(count, step_ms);
+}
+
+void led_blink(uint16_t period_ms)
+{
+	led_steps[0] = LED_ON;
+	led_steps[1] = 0;
+	led_start(2, period_ms / 2);
+}
+
+/*
+ * Fades in and out along the gamma curve.
+ */
+void led_breathe(uint16_t period_ms)
+{
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		led_steps[i] = pgm_read_word(&led_gamma[i]);
+		led_steps[31 - i] = led_steps[i];
+	}
+	led_start(32, period_ms / 32);
+}
+
+/*
+ * Blinks flashes times and stays off for four steps, for error and
+ * status codes.
+ */
+void led_code(uint8_t flashes, uint16_t step_ms)
+{
+	uint8_t n = 0;
+
+	if (flashes == 0 || flashes > (LED_MAX_STEPS - 4) / 2)
+		return;
+	while (flashes--)
+	{
+		led_steps[n++] = LED_ON;
+		led_steps[n++] = 0;
+	}
+	for (uint8_t i = 0; i < 4; i++)
+		led_steps[n++] = 0;
+	led_start(n, step_ms);
+}
@@ -0,0 +1,32 @@
+/*
+ * led.h
+ *
+ * LED patterns on PE0 without CPU time. TCE0 makes a PWM signal on PE0.
+ * TCD1 counts PWM periods through event channel 0. Each overflow of TCD1
+ * is routed through event channel 1 to DMA channel 2, which copies the
+ * next duty cycle of the pattern into TCE0.CCABUF. The DMA channel
+ * repeats the pattern forever, so the CPU only works when the pattern
+ * changes.
+ */
+
+#ifndef LED_H_
+#define LED_H_
+
+#include <stdint.h>
+#include "clock.h"
+
+#define LED_TC			TCE0						// PWM, OC0A on PE0
+#define LED_STEP_TC		TCD1						// pattern step timer
+#define LED_DMA			DMA.CH2
+#define LED_PWM_TOP		1023						// 10 bit duty cycle
+#define LED_PWM_HZ		(F_CPU / (LED_PWM_TOP + 1))	// 31.25 kHz
+#define LED_ON			(LED_PWM_TOP + 1)			// duty cycle of a fully lit LED
+#define LED_MAX_STEPS	32							// steps of a pattern
+
+void led_init(void);
+void led_pattern(const uint16_t *duty, uint8_t count, uint16_t step_ms);
+void led_blink(uint16_t period_ms);
+void led_breathe(uint16_t period_ms);
+void led_code(uint8_t flashes, uint16_t step_ms);
+
+#endif /* LED_H_ */
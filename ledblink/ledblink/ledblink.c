@@ -5,18 +5,44 @@
  *  Author: Matthijs
  */ 
 
-#define  F_CPU 2000000UL
-
 #include <avr/io.h>
-#include <util/delay.h>
+#include <avr/interrupt.h>
+#include "clock.h"
+#include "sched.h"
+#include "led.h"
 
-int main(void) {
-	PORTE.DIRSET = PIN0_bm;
-	
-	while (0) {
-
-		PORTE_OUTTGL = PIN0_bm;
-		_delay_ms(1000);
+#define DEMO_MS 10000								// time per pattern
 
+/*
+ * Shows the patterns one after the other. The CPU only runs when the
+ * pattern changes, the LED itself is driven by hardware.
+ */
+void demo_task(void)
+{
+	static uint8_t pattern = 0;
+	
+	switch (pattern)
+	{
+	case 0:
+		led_blink(1000);
+		break;
+	case 1:
+		led_breathe(2000);
+		break;
+	case 2:
+		led_code(3, 200);
+		break;
 	}
+	pattern = (pattern + 1) % 3;
+}
+
+int main(void) {
+	clock_init();
+	sched_init();
+	led_init();
+	
+	sched_add(demo_task, DEMO_MS, 10);
+	sei();
+	
+	sched_run();
 }
\ No newline at end of file